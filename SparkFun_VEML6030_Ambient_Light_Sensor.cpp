@@ -9,19 +9,16 @@
  */
 
 #include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include <math.h>
-#include <QMessageBox>
-#include <QDebug>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/ioctl.h>
-#include <fcntl.h>
-#include <linux/i2c-dev.h>
-#include <linux/i2c.h>
 
 #include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_transport.h"
+#include "veml6030_clock.h"
+#include "veml6030_retry.h"
 
 /* File hexDump.c created by Ken Aaker on Fri Aug  8 2003. */
 extern "C" void hex_dump(const char *title, void *mem, int len) {
@@ -81,41 +78,245 @@ static void delay(unsigned int delay_for_milliseconds) {
     usleep(delay_for_milliseconds * 1000);
 }
 
+// This function returns the lux per count for the raw gain and integration time
+// bits. The arrays above are indexed by gain from most to least sensitive (2, 1,
+// 1/4, 1/8), while the gain bits encode 1, 2, 1/8, 1/4, hence the index swap.
+static constexpr float lux_per_count_for_bits(int gain_bits, int integration_time_bits) {
+    return (integration_time_bits == 0)    ? one_high_integration_time[gain_bits ^ 1]
+           : (integration_time_bits == 1)  ? two_high_integration_time[gain_bits ^ 1]
+           : (integration_time_bits == 2)  ? four_high_integration_time[gain_bits ^ 1]
+           : (integration_time_bits == 3)  ? eight_high_integration_time[gain_bits ^ 1]
+           : (integration_time_bits == 8)  ? fifty_integration_time[gain_bits ^ 1]
+           : (integration_time_bits == 12) ? twenty_integration_time[gain_bits ^ 1]
+                                           : 0;
+}
+
+static constexpr veml6030_conversion conversion_entry(int gain_bits, int integration_time_bits) {
+    return {lux_per_count_for_bits(gain_bits, integration_time_bits),
+            (lux_per_count_for_bits(gain_bits, integration_time_bits) == 0)
+                ? 0
+                : (1 / lux_per_count_for_bits(gain_bits, integration_time_bits))};
+}
+
+#define CONVERSION_ROW(gain_bits)                                                             \
+    conversion_entry(gain_bits, 0), conversion_entry(gain_bits, 1), conversion_entry(gain_bits, 2),    \
+    conversion_entry(gain_bits, 3), conversion_entry(gain_bits, 4), conversion_entry(gain_bits, 5),    \
+    conversion_entry(gain_bits, 6), conversion_entry(gain_bits, 7), conversion_entry(gain_bits, 8),    \
+    conversion_entry(gain_bits, 9), conversion_entry(gain_bits, 10), conversion_entry(gain_bits, 11),  \
+    conversion_entry(gain_bits, 12), conversion_entry(gain_bits, 13), conversion_entry(gain_bits, 14), \
+    conversion_entry(gain_bits, 15)
+
+// Conversion factors for every gain (row) and integration time (column) encoding,
+// built at compile time. The index is the two gain bits above the four
+// integration time bits, so it comes straight from SETTING_REG.
+static constexpr veml6030_conversion conversion_table[4 * 16] = {
+    CONVERSION_ROW(0), CONVERSION_ROW(1), CONVERSION_ROW(2), CONVERSION_ROW(3)
+};
+#undef CONVERSION_ROW
+
+// This function returns the conversion factors for the gain and integration time
+// fields of a SETTING_REG value.
+const veml6030_conversion &veml6030_conversion_for(uint16_t setting_reg) {
+    return conversion_table[((setting_reg & GAIN_MASK) >> (GAIN_POS - 4)) |
+                            ((setting_reg & INTEGRATION_TIME_MASK) >> INTEGRATION_TIME_POS)];
+}
+
+// This function compensates lux values over 1000 with the polynomial from pg 10
+// of the datasheet, in Horner form:
+//   6.0135e-13 x^4 - 9.3924e-9 x^3 + 8.1488e-5 x^2 + 1.0023 x
+uint32_t veml6030_lux_compensation(uint32_t lux_value) {
+    double x = lux_value;
+
+    uint32_t compensated_lux = x * (1.0023 + (x * (.000081488 + (x * (-.0000000093924 + (x * .00000000000060135))))));
+    return compensated_lux;
+}
+
+// This function is the fixed point version of the compensation above. The x^4,
+// x^3 and x^2 coefficients are scaled by 2^64 and the x coefficient by 2^32. The
+// inner product is rescaled to 2^32 before the last two multiplies so no
+// intermediate value exceeds 63 bits for inputs below 2^17.
+uint32_t veml6030_lux_compensation_fixed(uint32_t lux_value) {
+    static const int64_t a4 = 11092950;           /*  6.0135e-13 * 2^64 */
+    static const int64_t a3 = -173259199038LL;    /* -9.3924e-9 * 2^64 */
+    static const int64_t a2 = 1503188281078444LL; /*  8.1488e-5 * 2^64 */
+    static const int64_t a1 = 4304845721LL;       /*  1.0023 * 2^32 */
+    int64_t x = (lux_value > 0x1FFFF) ? 0x1FFFF : lux_value;
+    int64_t term;
+
+    term = (a4 * x) + a3;
+    term = (term * x) + a2; /* Always positive from here on. */
+    term = term >> 32;
+    term = (term * x) + a1;
+    term = term * x;
+    return (uint32_t)(term >> 32);
+}
+
+// Auto range steps from least to most sensitive, following the application note:
+// bright light shortens the integration time at gain 1/8, otherwise the gain is
+// raised at 100ms before the integration time is lengthened at gain 2. Adjacent
+// steps differ by at most a factor of 4 in counts per lux.
+struct auto_range_setting {
+    uint16_t gain_bits;
+    uint16_t integration_time_bits;
+    float lux_per_count;
+};
+
+static const auto_range_setting auto_range_steps[] = {
+    {2, 12, twenty_integration_time[3]},    /* 1/8, 25ms */
+    {2, 8, fifty_integration_time[3]},      /* 1/8, 50ms */
+    {2, 0, one_high_integration_time[3]},   /* 1/8, 100ms */
+    {3, 0, one_high_integration_time[2]},   /* 1/4, 100ms */
+    {0, 0, one_high_integration_time[1]},   /* 1, 100ms */
+    {1, 0, one_high_integration_time[0]},   /* 2, 100ms */
+    {1, 1, two_high_integration_time[0]},   /* 2, 200ms */
+    {1, 2, four_high_integration_time[0]},  /* 2, 400ms */
+    {1, 3, eight_high_integration_time[0]}, /* 2, 800ms */
+};
+static const int auto_range_step_count = sizeof(auto_range_steps) / sizeof(auto_range_steps[0]);
+static const int auto_range_start_step = 2;
+
+// Auto range band in raw counts, from the application note. After a range
+// change the new range is picked to land at or below the target, which is far
+// enough inside the band that noise can't bounce the range straight back.
+static const uint16_t auto_range_low_counts = 100;
+static const uint16_t auto_range_high_counts = 10000;
+static const uint16_t auto_range_target_counts = 5000;
+static const uint16_t saturated_counts = 0xFFFF;
+
+const veml6030_retry_policy veml6030_default_retry_policy = {3, 1000000, 20000000, 5};
+
+// This function returns the SETTING_REG gain bits for a gain of 1/8, 1/4, 1 or
+// 2, or -1 for any other value.
+static int gain_bits_for(float gain_val) {
+    if (gain_val == 1.00)
+        return 0;
+    else if (gain_val == 2.00)
+        return 1;
+    else if (gain_val == .125)
+        return 2;
+    else if (gain_val == .25)
+        return 3;
+    return -1;
+}
+
+// This function returns the SETTING_REG integration time bits for a time in
+// milliseconds, or -1 if the sensor doesn't support it.
+static int integration_time_bits_for(uint16_t time) {
+    if (time == 100) // Default setting.
+        return 0;
+    else if (time == 200)
+        return 1;
+    else if (time == 400)
+        return 2;
+    else if (time == 800)
+        return 3;
+    else if (time == 50)
+        return 8;
+    else if (time == 25)
+        return 12;
+    return -1;
+}
+
 SparkFun_Ambient_Light::SparkFun_Ambient_Light(int address) {
     static const char *i2c_bus_name = "/dev/i2c-1";
-
-    fd_i2c_file = open(i2c_bus_name, O_RDWR);
-    if (fd_i2c_file < 0) {
-        QMessageBox file_open_msg;
-        file_open_msg.setText("i2c bus didn't open. Quitting");
-        file_open_msg.exec();
+    linux_i2c_transport *i2c_bus = new linux_i2c_transport(i2c_bus_name);
+
+    transport = i2c_bus;
+    owns_transport = true;
+    slave_address = address;
+    shadow_registers_valid = false;
+    config_generation = 0;
+    config_change_ns = 0;
+    auto_range_enabled = false;
+    auto_range_step = 0;
+    settle_until_ns = 0;
+    lux_table_enabled = false;
+    lux_table_valid = false;
+    lux_table_setting = 0;
+    retry_policy = veml6030_default_retry_policy;
+    last_status = 0;
+    consecutive_failures = 0;
+    recoveries = 0;
+    recovering = false;
+    initialized = false;
+    if (!i2c_bus->is_open()) {
+        fprintf(stderr, "i2c bus %s didn't open.\n", i2c_bus_name);
     } else {
-        slave_address = address;
-        if (ioctl(fd_i2c_file, I2C_SLAVE, slave_address) < 0) {
-            QMessageBox i2c_addr_set_msg;
-            i2c_addr_set_msg.setText("Couldn't set light sensor i2c address. Quitting");
-            i2c_addr_set_msg.exec();
-        } else {
-            /*
-             * Possible values: .125(1/8), .25(1/4), 1, 2
-             * Both .125 and .25 should be used in most cases except darker rooms.
-             * A gain of 2 should only be used if the sensor will be covered by a dark
-             * glass.
-             */
-            float gain = .125;
-            /*
-             * Possible integration times in milliseconds: 800, 400, 200, 100, 50, 25
-             * Higher times give higher resolutions and should be used in darker light.
-             */
-            int integration_time = 50;
-
-            power_on();
-            set_gain(gain);
-            set_integration_time(integration_time);
-        }
+        initialize();
     }
 } //Constructor for I2C
 
+SparkFun_Ambient_Light::SparkFun_Ambient_Light(veml6030_transport *transport, int address) {
+    this->transport = transport;
+    owns_transport = false;
+    slave_address = address;
+    shadow_registers_valid = false;
+    config_generation = 0;
+    config_change_ns = 0;
+    auto_range_enabled = false;
+    auto_range_step = 0;
+    settle_until_ns = 0;
+    lux_table_enabled = false;
+    lux_table_valid = false;
+    lux_table_setting = 0;
+    retry_policy = veml6030_default_retry_policy;
+    last_status = 0;
+    consecutive_failures = 0;
+    recoveries = 0;
+    recovering = false;
+    initialized = false;
+    initialize();
+}
+
+SparkFun_Ambient_Light::~SparkFun_Ambient_Light() {
+    if (owns_transport) {
+        delete transport;
+    }
+}
+
+// This function returns true if the sensor answered and was configured. If the
+// sensor didn't answer when the object was constructed, the setup is retried.
+bool SparkFun_Ambient_Light::begin(void) {
+    if (!initialized) {
+        initialize();
+    }
+    return initialized;
+}
+
+// This function loads the shadow registers and applies the default power, gain
+// and integration time settings. It returns false if the sensor didn't answer.
+bool SparkFun_Ambient_Light::initialize() {
+    /*
+     * Possible values: .125(1/8), .25(1/4), 1, 2
+     * Both .125 and .25 should be used in most cases except darker rooms.
+     * A gain of 2 should only be used if the sensor will be covered by a dark
+     * glass.
+     */
+    float gain = .125;
+    /*
+     * Possible integration times in milliseconds: 800, 400, 200, 100, 50, 25
+     * Higher times give higher resolutions and should be used in darker light.
+     */
+    int integration_time = 50;
+
+    if (!load_shadow_registers()) {
+        fprintf(stderr, "Light sensor at i2c address 0x%02x didn't answer.\n", slave_address);
+        initialized = false;
+        return false;
+    }
+    /*
+     * No power up delay here: the writes below restart the conversion cycle,
+     * and nothing is read until a conversion with them has completed, which is
+     * far longer than the 4ms the sensor needs. This keeps constructing many
+     * sensors from blocking.
+     */
+    start_power_on();
+    set_gain(gain);
+    set_integration_time(integration_time);
+    initialized = true;
+    return true;
+}
+
 // REG0x00, bits [12:11]
 // This function sets the gain for the Ambient Light Sensor. Possible values
 // are 1/8, 1/4, 1, and 2. The highest setting should only be used if the
@@ -123,17 +324,9 @@ SparkFun_Ambient_Light::SparkFun_Ambient_Light(int address) {
 // dark rooms. The datasheet suggests always leaving it at around 1/4 or 1/8.
 void SparkFun_Ambient_Light::set_gain(float gain_val) {
 
-    uint16_t bits;
+    int bits = gain_bits_for(gain_val);
 
-    if (gain_val == 1.00)
-        bits = 0;
-    else if (gain_val == 2.00)
-        bits = 1;
-    else if (gain_val == .125)
-        bits = 2;
-    else if (gain_val == .25)
-        bits = 3;
-    else
+    if (bits < 0)
         return;
 
     write_register(SETTING_REG, bits, -GAIN_POS, GAIN_MASK);
@@ -170,22 +363,9 @@ float SparkFun_Ambient_Light::read_gain() {
 // resolution but slower sensor refresh times.
 void SparkFun_Ambient_Light::set_integration_time(uint16_t time) {
 
-    uint16_t bits;
-    uint8_t reg_value;
+    int bits = integration_time_bits_for(time);
 
-    if (time == 100) // Default setting.
-        bits = 0;
-    else if (time == 200)
-        bits = 1;
-    else if (time == 400)
-        bits = 2;
-    else if (time == 800)
-        bits = 3;
-    else if (time == 50)
-        bits = 8;
-    else if (time == 25)
-        bits = 12;
-    else
+    if (bits < 0)
         return;
 
     write_register(SETTING_REG, bits, -INTEGRATION_TIME_POS, INTEGRATION_TIME_MASK);
@@ -290,8 +470,16 @@ void SparkFun_Ambient_Light::shut_down() {
 // osciallator and signal processor to power up.
 void SparkFun_Ambient_Light::power_on() {
 
+    start_power_on();
+    delay(power_up_delay_ms);
+}
+
+// REG0x00, bit[0]
+// This function powers up the Ambient Light Sensor without the delay. The
+// sensor is ready power_up_delay_ms later.
+void SparkFun_Ambient_Light::start_power_on() {
+
     write_register(SETTING_REG, POWER, -SHUTDOWN_POS, SHUTDOWN_MASK);
-    delay(4);
 }
 
 // REG0x03, bit[0]
@@ -299,7 +487,7 @@ void SparkFun_Ambient_Light::power_on() {
 // Light Sensor into power save mode.
 void SparkFun_Ambient_Light::enable_power_save() {
 
-    write_register(POWER_SAVE_REG, ENABLE, -POWER_SAVE_MODE_POS, POWER_SAVE_MODE_ENABLE_MASK);
+    write_register(POWER_SAVE_REG, ENABLE, -POWER_SAVE_MODE_ENABLE_POS, POWER_SAVE_MODE_ENABLE_MASK);
 }
 
 // REG0x03, bit[0]
@@ -307,7 +495,7 @@ void SparkFun_Ambient_Light::enable_power_save() {
 // Light Sensor out of power save mode.
 void SparkFun_Ambient_Light::disable_power_save() {
 
-    write_register(POWER_SAVE_REG, DISABLE, -POWER_SAVE_MODE_POS, POWER_SAVE_MODE_ENABLE_MASK);
+    write_register(POWER_SAVE_REG, DISABLE, -POWER_SAVE_MODE_ENABLE_POS, POWER_SAVE_MODE_ENABLE_MASK);
 }
 
 // REG0x03, bit[0]
@@ -338,7 +526,7 @@ void SparkFun_Ambient_Light::set_power_save_mode(uint16_t mode_value) {
     else
         return;
 
-    write_register(POWER_SAVE_REG, bits, -POWER_SAVE_MODE_ENABLE_POS, POWER_SAVE_MODE_MASK);
+    write_register(POWER_SAVE_REG, bits, -POWER_SAVE_MODE_POS, POWER_SAVE_MODE_MASK);
 }
 
 // REG0x03, bit[2:1]
@@ -348,7 +536,7 @@ void SparkFun_Ambient_Light::set_power_save_mode(uint16_t mode_value) {
 // continually sampling the sensor.
 uint8_t SparkFun_Ambient_Light::read_power_save_mode() {
 
-    uint16_t reg_value = read_register(POWER_SAVE_REG, POWER_SAVE_MODE_ENABLE_POS, POWER_SAVE_MODE_ENABLE_MASK);
+    uint16_t reg_value = read_register(POWER_SAVE_REG, POWER_SAVE_MODE_POS, POWER_SAVE_MODE_MASK);
 
     if (reg_value == 0)
         return 1;
@@ -362,6 +550,70 @@ uint8_t SparkFun_Ambient_Light::read_power_save_mode() {
         return UNKNOWN_ERROR;
 }
 
+// REG0x00, bits[12:11] and bits[9:6], and REG0x03, bits[2:0]
+// This function sets the gain, integration time and power save mode together.
+// The new register values are merged into the shadow copy, and each of
+// SETTING_REG and POWER_SAVE_REG is written only if it changes, so applying a
+// configuration costs at most two bus transactions. power_save_mode 0 disables
+// power save mode. It returns 0, -EINVAL for an unsupported value, or the
+// negative errno value of the failed access.
+int SparkFun_Ambient_Light::set_configuration(float gain_val, uint16_t integration_time,
+                                              uint16_t power_save_mode) {
+    int gain_bits = gain_bits_for(gain_val);
+    int integration_time_bits = integration_time_bits_for(integration_time);
+    uint16_t setting_reg;
+    uint16_t power_save_reg;
+    int status = 0;
+
+    if ((gain_bits < 0) || (integration_time_bits < 0) || (power_save_mode > 4)) {
+        return -EINVAL;
+    }
+    if (!shadow_registers_valid && !load_shadow_registers()) {
+        return last_status;
+    }
+    setting_reg = (shadow_registers[SETTING_REG] & ~(GAIN_MASK | INTEGRATION_TIME_MASK)) |
+                  (gain_bits << GAIN_POS) | (integration_time_bits << INTEGRATION_TIME_POS);
+    power_save_reg = shadow_registers[POWER_SAVE_REG] & ~(POWER_SAVE_MODE_MASK | POWER_SAVE_MODE_ENABLE_MASK);
+    if (power_save_mode != 0) {
+        power_save_reg |= ((power_save_mode - 1) << POWER_SAVE_MODE_POS) | (ENABLE << POWER_SAVE_MODE_ENABLE_POS);
+    }
+    if (setting_reg != shadow_registers[SETTING_REG]) {
+        status = write_register_checked(SETTING_REG, setting_reg);
+    }
+    if ((status == 0) && (power_save_reg != shadow_registers[POWER_SAVE_REG])) {
+        status = write_register_checked(POWER_SAVE_REG, power_save_reg);
+    }
+    return status;
+}
+
+// REG0x00, bits[9:6] and REG0x03, bits[2:0]
+// This function returns how often the sensor produces a new light reading, in
+// milliseconds: the integration time, plus the power save mode wait time when
+// power save mode is enabled.
+uint32_t SparkFun_Ambient_Light::read_refresh_period_ms() {
+
+    // Power save mode wait times from the datasheet, indexed by the mode bits.
+    static const uint32_t power_save_wait_ms[] = {500, 1000, 2000, 4000};
+    uint32_t refresh_period_ms = read_integtration_time();
+
+    if (read_power_save_enabled() == ENABLE) {
+        uint16_t mode_bits = read_register(POWER_SAVE_REG, POWER_SAVE_MODE_POS, POWER_SAVE_MODE_MASK);
+        refresh_period_ms += power_save_wait_ms[mode_bits & 0x03];
+    }
+    return refresh_period_ms;
+}
+
+// This function returns a number that changes whenever the sensor's conversion
+// timing is changed or found changed on a reload.
+uint32_t SparkFun_Ambient_Light::get_config_generation() const {
+    return config_generation;
+}
+
+// This function returns the CLOCK_MONOTONIC time the configuration last changed.
+int64_t SparkFun_Ambient_Light::get_config_change_ns() const {
+    return config_change_ns;
+}
+
 // REG0x06, bits[15:14]
 // This function reads the interrupt register to see if an interrupt has been
 // triggered. There are two possible interrupts: a lower limit and upper limit
@@ -431,16 +683,25 @@ uint32_t SparkFun_Ambient_Light::read_high_threshold() {
 // determined based on current gain and integration time settings. If the lux
 // value exceeds 1000 then a compensation formula is applied to it.
 uint32_t SparkFun_Ambient_Light::read_light() {
+    uint32_t lux_value;
 
-    uint16_t light_bits = read_register(AMBIENT_LIGHT_DATA_REG, AMBIENT_LIGHT_DATA_POS, AMBIENT_LIGHT_DATA_MASK);
-    uint32_t lux_value = calculate_lux(light_bits);
+    if (!read_light(lux_value)) {
+        return 0;
+    }
+    return lux_value;
+}
 
-    if (lux_value > 1000) {
-        uint32_t compensated_lux = lux_compensation(lux_value);
-        return compensated_lux;
-    } else {
-        return lux_value;
+// REG[0x04], bits[15:0]
+// This function reads the ambient light's lux value into lux_value. It returns
+// false if the read failed, in which case lux_value isn't changed.
+bool SparkFun_Ambient_Light::read_light(uint32_t &lux_value) {
+    uint16_t light_bits;
+
+    if (!raw_read_register(AMBIENT_LIGHT_DATA_REG, light_bits)) {
+        return false;
     }
+    lux_value = light_bits_to_lux(light_bits);
+    return true;
 }
 
 // REG[0x05], bits[15:0]
@@ -448,16 +709,255 @@ uint32_t SparkFun_Ambient_Light::read_light() {
 // determined based on current gain and integration time settings. If the lux
 // value exceeds 1000 then a compensation formula is applied to it.
 uint32_t SparkFun_Ambient_Light::read_white_light() {
+    uint32_t lux_value;
 
-    uint16_t light_bits = read_register(WHITE_LIGHT_DATA_REG, WHITE_LIGHT_DATA_POS, WHITE_LIGHT_DATA_MASK);
-    uint32_t lux_value = calculate_lux(light_bits);
+    if (!read_white_light(lux_value)) {
+        return 0;
+    }
+    return lux_value;
+}
 
-    if (lux_value > 1000) {
-        uint32_t compLux = lux_compensation(lux_value);
-        return compLux;
+// REG[0x05], bits[15:0]
+// This function reads the white light's lux value into lux_value. It returns
+// false if the read failed, in which case lux_value isn't changed.
+bool SparkFun_Ambient_Light::read_white_light(uint32_t &lux_value) {
+    uint16_t light_bits;
+
+    if (!raw_read_register(WHITE_LIGHT_DATA_REG, light_bits)) {
+        return false;
+    }
+    lux_value = light_bits_to_lux(light_bits);
+    return true;
+}
+
+// REG[0x04], REG[0x05] and optionally REG[0x06]
+// This function reads both light channels (and the interrupt status if
+// read_interrupt_status is true) in a single bus transaction and converts them
+// with the current gain and integration time.
+bool SparkFun_Ambient_Light::read_sample(veml6030_sample &sample, bool read_interrupt_status) {
+    veml6030_register_read reads[3];
+    int read_count = 2;
+
+    if (!shadow_registers_valid && !load_shadow_registers()) {
+        return false;
+    }
+    reads[0].slave_address = slave_address;
+    reads[0].reg = AMBIENT_LIGHT_DATA_REG;
+    reads[1].slave_address = slave_address;
+    reads[1].reg = WHITE_LIGHT_DATA_REG;
+    if (read_interrupt_status) {
+        reads[2].slave_address = slave_address;
+        reads[2].reg = INTERRUPT_STATUS_REG;
+        read_count = 3;
+    }
+    if (retry_access([&]() { return transport->read_registers(reads, read_count); }) < 0) {
+        return false;
+    }
+
+    sample.ambient_light_bits = reads[0].reg_value;
+    sample.white_light_bits = reads[1].reg_value;
+    sample.interrupt_status = NO_INT;
+    if (read_interrupt_status) {
+        uint16_t status_bits = (reads[2].reg_value & INTERRUPT_STATUS_MASK) >> INTERRUPT_STATUS_POS;
+
+        if (status_bits == 1)
+            sample.interrupt_status = INT_HIGH;
+        else if (status_bits == 2)
+            sample.interrupt_status = INT_LOW;
+    }
+    return convert_sample(sample);
+}
+
+// This function fills in the lux and configuration fields of a sample whose raw
+// light bits were read elsewhere. It returns false if the sensor configuration
+// isn't known.
+bool SparkFun_Ambient_Light::convert_sample(veml6030_sample &sample) {
+
+    if (!shadow_registers_valid) {
+        return false;
+    }
+    sample.setting_reg = shadow_registers[SETTING_REG];
+    sample.power_save_reg = shadow_registers[POWER_SAVE_REG];
+    sample.ambient_light_lux = light_bits_to_lux(sample.ambient_light_bits);
+    sample.white_light_lux = light_bits_to_lux(sample.white_light_bits);
+    sample.settled = true;
+    if ((settle_until_ns != 0) && (veml6030_monotonic_ns() < settle_until_ns)) {
+        sample.settled = false;
     } else {
-        return lux_value;
+        settle_until_ns = 0;
+        if (auto_range_enabled) {
+            auto_range_update(sample.ambient_light_bits);
+        }
+    }
+    return true;
+}
+
+// REG0x00, bits[12:11] and bits[9:6]
+// This function turns on automatic ranging. If the current gain and integration
+// time aren't one of the auto range steps, ranging starts from 1/8 at 100ms.
+void SparkFun_Ambient_Light::enable_auto_range() {
+    uint16_t gain_bits = read_register(SETTING_REG, GAIN_POS, GAIN_MASK);
+    uint16_t integration_time_bits = read_register(SETTING_REG, INTEGRATION_TIME_POS, INTEGRATION_TIME_MASK);
+
+    auto_range_enabled = true;
+    for (int step = 0; step < auto_range_step_count; ++step) {
+        if ((auto_range_steps[step].gain_bits == gain_bits) &&
+            (auto_range_steps[step].integration_time_bits == integration_time_bits)) {
+            auto_range_step = step;
+            return;
+        }
     }
+    set_auto_range_step(auto_range_start_step);
+}
+
+// REG0x00, bits[12:11] and bits[9:6]
+// This function turns off automatic ranging, leaving the current range set.
+void SparkFun_Ambient_Light::disable_auto_range() {
+    auto_range_enabled = false;
+}
+
+// This function checks if automatic ranging is enabled.
+bool SparkFun_Ambient_Light::read_auto_range_enabled() {
+    return auto_range_enabled;
+}
+
+// This function checks the raw count of a converted sample and changes range if
+// it is outside the auto range band. The light level is estimated from the
+// current range, and the new range is the most sensitive one that would put it
+// at or below the target count, so a large change settles in one step.
+void SparkFun_Ambient_Light::auto_range_update(uint16_t light_bits) {
+    float lux_estimate;
+    int new_step;
+
+    if (light_bits == saturated_counts) {
+        new_step = 0;
+    } else if ((light_bits > auto_range_high_counts) ||
+               ((light_bits < auto_range_low_counts) && (auto_range_step < (auto_range_step_count - 1)))) {
+        lux_estimate = light_bits * auto_range_steps[auto_range_step].lux_per_count;
+        new_step = 0;
+        for (int step = auto_range_step_count - 1; step > 0; --step) {
+            if ((lux_estimate / auto_range_steps[step].lux_per_count) <= auto_range_target_counts) {
+                new_step = step;
+                break;
+            }
+        }
+    } else {
+        return;
+    }
+    if (new_step != auto_range_step) {
+        set_auto_range_step(new_step);
+    }
+}
+
+// This function sets the gain and integration time fields of SETTING_REG in one
+// register write. The sample that completes first with the new range may have
+// started with the old one, so write_register() marks samples not settled until
+// a second conversion (plus a margin for the sensor's oscillator tolerance) has
+// completed.
+void SparkFun_Ambient_Light::set_auto_range_step(int step) {
+    uint16_t range_bits = (auto_range_steps[step].gain_bits << GAIN_POS) |
+                          (auto_range_steps[step].integration_time_bits << INTEGRATION_TIME_POS);
+
+    write_register(SETTING_REG, range_bits, NO_SHIFT, GAIN_MASK | INTEGRATION_TIME_MASK);
+    auto_range_step = step;
+}
+
+// This function marks samples not settled until a second conversion with the
+// configuration written at config_change_ns (plus a margin for the sensor's
+// oscillator tolerance) has completed.
+void SparkFun_Ambient_Light::start_settling() {
+    int64_t settle_ns = (int64_t)read_refresh_period_ms() * 1000000 * 2;
+
+    settle_until_ns = config_change_ns + settle_ns + (settle_ns / 20);
+}
+
+// Bits of SETTING_REG and POWER_SAVE_REG that set the conversion timing. A write
+// that changes any of them restarts the sensor's conversion cycle.
+static const uint16_t setting_timing_mask = GAIN_MASK | INTEGRATION_TIME_MASK | SHUTDOWN_MASK;
+static const uint16_t power_save_timing_mask = POWER_SAVE_MODE_MASK | POWER_SAVE_MODE_ENABLE_MASK;
+
+// This function returns true if changing reg from old_value to new_value changes
+// the conversion timing.
+static bool timing_changed(int reg, uint16_t old_value, uint16_t new_value) {
+    if (reg == SETTING_REG) {
+        return ((old_value ^ new_value) & setting_timing_mask) != 0;
+    }
+    if (reg == POWER_SAVE_REG) {
+        return ((old_value ^ new_value) & power_save_timing_mask) != 0;
+    }
+    return false;
+}
+
+// This function records a configuration register write. Only the timing fields
+// restart the sensor's conversion cycle; interrupt and persistence bits don't.
+void SparkFun_Ambient_Light::configuration_written(VEML6030_16BIT_REGISTERS write_reg, uint16_t old_value,
+                                                   uint16_t new_value) {
+    if (timing_changed(write_reg, old_value, new_value)) {
+        ++config_generation;
+        config_change_ns = veml6030_monotonic_ns();
+        start_settling();
+    }
+}
+
+int SparkFun_Ambient_Light::get_address() const {
+    return slave_address;
+}
+
+veml6030_transport *SparkFun_Ambient_Light::get_transport() const {
+    return transport;
+}
+
+// REG0x00 - REG0x03
+// This function re-reads the writable registers from the sensor and compares
+// them with the driver's cached copy. It returns true if they all matched. The
+// cache is reloaded from the sensor either way.
+bool SparkFun_Ambient_Light::validate_shadow_registers() {
+    uint16_t cached_registers[POWER_SAVE_REG + 1];
+    bool cache_was_valid = shadow_registers_valid;
+    bool matched = true;
+
+    for (int reg = SETTING_REG; reg <= POWER_SAVE_REG; ++reg) {
+        cached_registers[reg] = shadow_registers[reg];
+    }
+    if (!load_shadow_registers()) {
+        return false;
+    }
+    for (int reg = SETTING_REG; reg <= POWER_SAVE_REG; ++reg) {
+        if (cached_registers[reg] != shadow_registers[reg]) {
+            matched = false;
+        }
+    }
+    return (cache_was_valid && matched);
+}
+
+// This function loads the shadow registers from the sensor. It returns false if
+// any of the reads failed, in which case the shadow is left marked invalid. The
+// configuration generation only moves on for the first load, or if the timing
+// differs from the copy the driver had, so validating or reloading an unchanged
+// sensor doesn't make the conversion scheduler realign.
+bool SparkFun_Ambient_Light::load_shadow_registers() {
+    uint16_t previous_registers[POWER_SAVE_REG + 1];
+    bool previous_valid = shadow_registers_valid;
+    bool changed = !previous_valid;
+    uint16_t reg_value;
+
+    shadow_registers_valid = false;
+    for (int reg = SETTING_REG; reg <= POWER_SAVE_REG; ++reg) {
+        if (!raw_read_register((VEML6030_16BIT_REGISTERS)reg, reg_value)) {
+            return false;
+        }
+        previous_registers[reg] = shadow_registers[reg];
+        shadow_registers[reg] = reg_value;
+        if (timing_changed(reg, previous_registers[reg], reg_value)) {
+            changed = true;
+        }
+    }
+    shadow_registers_valid = true;
+    if (changed) {
+        ++config_generation;
+        config_change_ns = veml6030_monotonic_ns();
+    }
+    return true;
 }
 
 // This function compensates for lux values over 1000. From datasheet:
@@ -465,60 +965,81 @@ uint32_t SparkFun_Ambient_Light::read_white_light() {
 // non-linearity is the same for all sensors, so a compensation forumla..."
 // etc. etc.
 uint32_t SparkFun_Ambient_Light::lux_compensation(uint32_t lux_value) {
+#ifdef VEML6030_FIXED_POINT_COMPENSATION
+    return veml6030_lux_compensation_fixed(lux_value);
+#else
+    return veml6030_lux_compensation(lux_value);
+#endif
+}
 
-    // Polynomial is pulled from pg 10 of the datasheet.
-    uint32_t compensated_lux = (.00000000000060135 * (pow(lux_value, 4))) -
-                        (.0000000093924 * (pow(lux_value, 3))) +
-                        (.000081488 * (pow(lux_value, 2))) +
-                        (1.0023 * lux_value);
-    return compensated_lux;
+// This function converts a raw light channel count to lux, applying the
+// compensation formula above 1000 lux. With the lux table on, it is a table load.
+uint32_t SparkFun_Ambient_Light::light_bits_to_lux(uint16_t light_bits) {
+
+    /* Without a known configuration any conversion would be garbage. */
+    if (!shadow_registers_valid && !load_shadow_registers()) {
+        return 0;
+    }
+    if (lux_table_enabled) {
+        uint16_t setting_reg = read_register(SETTING_REG, NO_SHIFT, GAIN_MASK | INTEGRATION_TIME_MASK);
+
+        if (!lux_table_valid || (setting_reg != lux_table_setting)) {
+            build_lux_table(setting_reg);
+        }
+        return lux_table[light_bits];
+    }
+
+    uint32_t lux_value = calculate_lux(light_bits);
+
+    if (lux_value > 1000) {
+        return lux_compensation(lux_value);
+    }
+    return lux_value;
+}
+
+// This function turns on the lux lookup table. It is built on first use.
+void SparkFun_Ambient_Light::enable_lux_table() {
+    lux_table_enabled = true;
+}
+
+// This function turns off the lux lookup table and frees it.
+void SparkFun_Ambient_Light::disable_lux_table() {
+    lux_table_enabled = false;
+    lux_table_valid = false;
+    std::vector<uint32_t>().swap(lux_table);
+}
+
+// This function fills the lux lookup table for the gain and integration time bits
+// of setting_reg, with the same conversion and compensation as calculate_lux().
+void SparkFun_Ambient_Light::build_lux_table(uint16_t setting_reg) {
+    float lux_conversion = veml6030_conversion_for(setting_reg).lux_per_count;
+
+    lux_table.resize(0x10000);
+    for (uint32_t light_bits = 0; light_bits <= 0xFFFF; ++light_bits) {
+        uint32_t lux_value = (lux_conversion * light_bits);
+
+        if (lux_value > 1000) {
+            lux_value = lux_compensation(lux_value);
+        }
+        lux_table[light_bits] = lux_value;
+    }
+    lux_table_setting = setting_reg;
+    lux_table_valid = true;
 }
 
 // The lux value of the Ambient Light sensor depends on both the gain and the
-// integration time settings. This function determines which conversion value
-// to use by using the bit representation of the gain as an index to look up
-// the conversion value in the correct integration time array. It then converts
+// integration time settings. This function looks up the conversion value with
+// the gain and integration time bits of the setting register, then converts
 // the value and returns it.
 uint32_t SparkFun_Ambient_Light::calculate_lux(uint16_t light_bits) {
 
-    float lux_conversion;
-    uint8_t conv_position;
-    float gain = read_gain();
-    uint16_t integration_time = read_integtration_time();
-
-    // Here the gain is checked to get the position of the conversion value
-    // within the integration time arrays. These values also represent the bit
-    // values for setting the gain.
-    if (gain == 2.00)
-        conv_position = 0;
-    else if (gain == 1.00)
-        conv_position = 1;
-    else if (gain == .25)
-        conv_position = 2;
-    else if (gain == .125)
-        conv_position = 3;
-    else
-        return UNKNOWN_ERROR;
-
-    // Here we check the integration time which determines which array we probe
-    // at the position determined above.
-    if (integration_time == 800)
-        lux_conversion = eight_high_integration_time[conv_position];
-    else if (integration_time == 400)
-        lux_conversion = four_high_integration_time[conv_position];
-    else if (integration_time == 200)
-        lux_conversion = two_high_integration_time[conv_position];
-    else if (integration_time == 100)
-        lux_conversion = one_high_integration_time[conv_position];
-    else if (integration_time == 50)
-        lux_conversion = fifty_integration_time[conv_position];
-    else if (integration_time == 25)
-        lux_conversion = twenty_integration_time[conv_position];
-    else
-        return UNKNOWN_ERROR;
+    if (!shadow_registers_valid && !load_shadow_registers()) {
+        return 0;
+    }
+    uint16_t setting_reg = read_register(SETTING_REG, NO_SHIFT, GAIN_MASK | INTEGRATION_TIME_MASK);
 
     /* Multiply the value from the 16 bit register to the conversion value and return it.*/
-    uint32_t calculated_lux = (lux_conversion * light_bits);
+    uint32_t calculated_lux = (veml6030_conversion_for(setting_reg).lux_per_count * light_bits);
     return calculated_lux;
 }
 
@@ -529,117 +1050,177 @@ uint32_t SparkFun_Ambient_Light::calculate_lux(uint16_t light_bits) {
 // that.
 uint16_t SparkFun_Ambient_Light::calculate_bits(uint32_t lux_value) {
 
-    float lux_conversion;
-    uint8_t conv_position;
-
-    float gain = read_gain();
-    float integration_time = read_integtration_time();
-    // Here the gain is checked to get the position of the conversion value
-    // within the integration time arrays. These values also represent the bit
-    // values for setting the gain.
-    if (gain == 2.00)
-        conv_position = 0;
-    else if (gain == 1.00)
-        conv_position = 1;
-    else if (gain == .25)
-        conv_position = 2;
-    else if (gain == .125)
-        conv_position = 3;
-    else
-        return UNKNOWN_ERROR;
-
-    // Here we check the integration time which determines which array we probe
-    // at the position determined above.
-    if (integration_time == 800)
-        lux_conversion = eight_high_integration_time[conv_position];
-    else if (integration_time == 400)
-        lux_conversion = four_high_integration_time[conv_position];
-    else if (integration_time == 200)
-        lux_conversion = two_high_integration_time[conv_position];
-    else if (integration_time == 100)
-        lux_conversion = one_high_integration_time[conv_position];
-    else if (integration_time == 50)
-        lux_conversion = fifty_integration_time[conv_position];
-    else if (integration_time == 25)
-        lux_conversion = twenty_integration_time[conv_position];
-    else
-        return UNKNOWN_ERROR;
+    if (!shadow_registers_valid && !load_shadow_registers()) {
+        return 0;
+    }
+    uint16_t setting_reg = read_register(SETTING_REG, NO_SHIFT, GAIN_MASK | INTEGRATION_TIME_MASK);
 
-    // Divide the value of lux bythe conversion value and return
-    // it.
-    uint16_t calculated_bits = (lux_value / lux_conversion);
+    // Multiply the value of lux by the count per lux conversion value and return it.
+    uint16_t calculated_bits = (lux_value * veml6030_conversion_for(setting_reg).counts_per_lux);
     return calculated_bits;
 }
 
 // This function reads a 16 bit register. It takes the register's address as its parameter.
 uint16_t SparkFun_Ambient_Light::raw_read_register(VEML6030_16BIT_REGISTERS read_reg) {
     uint16_t reg_value;
-    struct i2c_msg messages[2];
-    struct i2c_rdwr_ioctl_data message_set[1];
-    uint8_t in_buffer[2];
-    uint8_t out_buffer[1];
-
-    /* Set up the output operation first. */
-    messages[0].addr = slave_address;
-    messages[0].flags = 0;
-    messages[0].len = sizeof(out_buffer);
-    messages[0].buf = out_buffer;
-
-    /* Now set up the input operation. */
-    messages[1].addr = slave_address;
-    messages[1].flags = (I2C_M_RD | I2C_M_NOSTART);
-    messages[1].len = sizeof(in_buffer);
-    messages[1].buf = in_buffer;
-
-    /* Now arrange things for the ioctl. */
-    message_set[0].msgs = messages;
-    message_set[0].nmsgs = 2;
-
-    out_buffer[0] = read_reg;
-
-    in_buffer[0] = read_reg;
-    in_buffer[1] = 0;
-    if (ioctl(fd_i2c_file, I2C_RDWR, &message_set) < 0) {
-        perror("ioctl(I2C_RDWR) in read_register");
-        reg_value =0xffff;
-    } else {
-        reg_value = (in_buffer[1] << 8) | in_buffer[0];
+
+    if (!raw_read_register(read_reg, reg_value)) {
+        reg_value = 0xffff;
     }
     return reg_value;
 }
 
-// This function writes to a 16 bit register. Paramaters include the register's address and the reg_value to write.
-void SparkFun_Ambient_Light::raw_write_register(VEML6030_16BIT_REGISTERS write_reg, uint16_t output_reg_value) {
-    struct i2c_msg messages[1];
-    struct i2c_rdwr_ioctl_data message_set[1];
-    uint8_t out_buffer[3];
+// This function reads a 16 bit register into reg_value, applying the retry policy.
+// It returns false if the read failed.
+bool SparkFun_Ambient_Light::raw_read_register(VEML6030_16BIT_REGISTERS read_reg, uint16_t &reg_value) {
+    return (retry_access([&]() { return transport->read_register(slave_address, read_reg, reg_value); }) == 0);
+}
+
+// This function writes to a 16 bit register, applying the retry policy. Paramaters include the
+// register's address and the reg_value to write. It returns false if the write failed.
+bool SparkFun_Ambient_Light::raw_write_register(VEML6030_16BIT_REGISTERS write_reg, uint16_t output_reg_value) {
+    return (retry_access([&]() { return transport->write_register(slave_address, write_reg, output_reg_value); }) ==
+            0);
+}
+
+// This function runs access under the retry policy and records its final status.
+template <typename Access>
+int SparkFun_Ambient_Light::retry_access(Access access) {
+    int status = veml6030_retry_access(retry_policy, transport->get_stats(), access);
+
+    finish_access(status);
+    return status;
+}
+
+// This function records the final status of an access. After
+// reopen_after_failures failed accesses in a row the bus is recovered.
+void SparkFun_Ambient_Light::finish_access(int status) {
+    if (report_shared_access(status) && !recovering) {
+        recover();
+    }
+}
+
+// This function records the status of an access made outside the driver.
+void SparkFun_Ambient_Light::report_access(int status) {
+    finish_access(status);
+}
+
+// This function records the status of an access and returns true once
+// reopen_after_failures accesses in a row have failed.
+bool SparkFun_Ambient_Light::report_shared_access(int status) {
+    last_status = status;
+    if (status == 0) {
+        consecutive_failures = 0;
+        return false;
+    }
+    ++consecutive_failures;
+    return ((retry_policy.reopen_after_failures > 0) && (consecutive_failures >= retry_policy.reopen_after_failures));
+}
+
+// This function reopens the transport and writes the driver's copy of the
+// configuration back to the sensor, which may have been reset by whatever went
+// wrong. It returns true if the sensor is configured again.
+bool SparkFun_Ambient_Light::recover() {
+    int reopen_status = transport->reopen();
+
+    if ((reopen_status < 0) && (reopen_status != -EOPNOTSUPP)) {
+        consecutive_failures = 0;
+        ++recoveries;
+        return false;
+    }
+    return restore_configuration();
+}
+
+// This function writes the configuration back. If there is no valid copy it is
+// loaded from the sensor instead. Samples aren't settled until the sensor has
+// converted with the restored configuration. The recovery's own accesses would
+// overwrite last_status, so the failure is put back afterwards: the access that
+// triggered recovery still failed.
+bool SparkFun_Ambient_Light::restore_configuration() {
+    int failed_status = last_status;
+    bool recovered = true;
+
+    recovering = true;
+    consecutive_failures = 0;
+    ++recoveries;
+    if (shadow_registers_valid) {
+        for (int reg = SETTING_REG; reg <= POWER_SAVE_REG; ++reg) {
+            if (!raw_write_register((VEML6030_16BIT_REGISTERS)reg, shadow_registers[reg])) {
+                recovered = false;
+                break;
+            }
+        }
+        if (recovered) {
+            ++config_generation;
+            config_change_ns = veml6030_monotonic_ns();
+        }
+    } else {
+        recovered = load_shadow_registers();
+    }
+    if (recovered) {
+        start_settling();
+    }
+    recovering = false;
+    last_status = failed_status;
+    return recovered;
+}
+
+// This function reads a whole register from the sensor, applying the retry policy.
+veml6030_register_result SparkFun_Ambient_Light::read_register_checked(VEML6030_16BIT_REGISTERS read_reg) {
+    veml6030_register_result result;
+
+    result.value = 0;
+    result.status = retry_access([&]() { return transport->read_register(slave_address, read_reg, result.value); });
+    return result;
+}
 
-    /* Set up the output operation. */
-    messages[0].addr = slave_address;
-    messages[0].flags = 0;
-    messages[0].len = sizeof(out_buffer);
-    messages[0].buf = out_buffer;
+// This function writes a whole register, applying the retry policy, and keeps the
+// shadow copy and configuration generation in step.
+int SparkFun_Ambient_Light::write_register_checked(VEML6030_16BIT_REGISTERS write_reg, uint16_t reg_value) {
+    int status = retry_access([&]() { return transport->write_register(slave_address, write_reg, reg_value); });
 
-    /* Now arrange things for the ioctl. */
-    message_set[0].msgs = messages;
-    message_set[0].nmsgs = 1;
+    if ((status == 0) && (write_reg <= POWER_SAVE_REG)) {
+        uint16_t old_value = shadow_registers[write_reg];
 
-    out_buffer[0] = (uint8_t)(write_reg & 0xff);
-    out_buffer[1] = (output_reg_value & 0xff);
-    out_buffer[2] = ((output_reg_value >> 8) & 0xff);
-    if (ioctl(fd_i2c_file, I2C_RDWR, &message_set) < 0) {
-        perror("ioctl(I2C_RDWR) in write_register");
+        shadow_registers[write_reg] = reg_value;
+        if (!shadow_registers_valid) {
+            /* The old timing isn't known, so assume the write changed it. */
+            old_value = ~reg_value;
+        }
+        configuration_written(write_reg, old_value, reg_value);
     }
+    return status;
+}
+
+int SparkFun_Ambient_Light::get_last_status() const {
+    return last_status;
+}
+
+void SparkFun_Ambient_Light::set_retry_policy(const veml6030_retry_policy &policy) {
+    retry_policy = policy;
+}
+
+const veml6030_retry_policy &SparkFun_Ambient_Light::get_retry_policy() const {
+    return retry_policy;
+}
+
+unsigned long SparkFun_Ambient_Light::get_recoveries() const {
+    return recoveries;
 }
 
 // This function reads a 16 bit register. It takes the register's address as its parameter.
 // The mask_value is used to mask the raw register value, then the value is shifted by the shift_value.
+// The writable registers are served from the shadow copy instead of the bus.
 uint16_t SparkFun_Ambient_Light::read_register(VEML6030_16BIT_REGISTERS read_reg,
                                                const int shift_value, const uint16_t mask_value) {
     uint16_t reg_value;
     int shift_amount;
 
-    reg_value = raw_read_register(read_reg);
+    if ((read_reg <= POWER_SAVE_REG) && (shadow_registers_valid || load_shadow_registers())) {
+        reg_value = shadow_registers[read_reg];
+    } else {
+        reg_value = raw_read_register(read_reg);
+    }
     shift_amount = abs(shift_value);
 
     reg_value = (reg_value & mask_value);
@@ -652,22 +1233,37 @@ uint16_t SparkFun_Ambient_Light::read_register(VEML6030_16BIT_REGISTERS read_reg
 }
 
 // This function writes to a 16 bit register. Paramaters include the register's address, a mask
-// for bits that are ignored, and the bits to write.
+// for bits that are ignored, and the bits to write. The existing register contents come from the
+// shadow copy when it is valid, so a write costs a single bus transaction. A change
+// to the conversion timing starts a settling period, since the next sample may
+// mix the old and new settings.
 void SparkFun_Ambient_Light::write_register(VEML6030_16BIT_REGISTERS write_reg, uint16_t output_bits,
                                             const int shift_value, const uint16_t output_mask) {
     int shift_amount;
     uint16_t existing_register;
     uint16_t updated_register;
+    bool cached = ((write_reg <= POWER_SAVE_REG) && shadow_registers_valid);
 
-    existing_register = raw_read_register(write_reg);
+    if (cached) {
+        existing_register = shadow_registers[write_reg];
+    } else if (!raw_read_register(write_reg, existing_register)) {
+        /* Merging into a register that couldn't be read would write garbage. */
+        return;
+    }
     updated_register = existing_register & ~output_mask;
 
     shift_amount = abs(shift_value);
     if (shift_value < 0) {
-        updated_register = updated_register | (output_bits << shift_amount);
+        output_bits = output_bits << shift_amount;
     } else if (shift_value > 0) {
-        updated_register = updated_register | (output_bits >> shift_amount);
+        output_bits = output_bits >> shift_amount;
     }
+    updated_register = updated_register | (output_bits & output_mask);
 
-    raw_write_register(write_reg, updated_register);
+    if (raw_write_register(write_reg, updated_register)) {
+        if (cached) {
+            shadow_registers[write_reg] = updated_register;
+        }
+        configuration_written(write_reg, existing_register, updated_register);
+    }
 }
@@ -1,6 +1,9 @@
 #ifndef _SPARKFUN_VEML6030_H_
 #define _SPARKFUN_VEML6030_H_
 
+#include <stdint.h>
+#include <vector>
+
 #define ENABLE 0x01
 #define DISABLE 0x00
 #define SHUTDOWN 0x01
@@ -60,17 +63,87 @@ enum REGISTER_BIT_POSITIONS {
 // The arrays represent the all possible integration times and the index of the
 // arrays represent the register's gain settings, which is directly analgous to
 // their bit representations.
-static const float eight_high_integration_time[] = {.0036, .0072, .0288, .0576};
-static const float four_high_integration_time[] = {.0072, .0144, .0576, .1152};
-static const float two_high_integration_time[] = {.0144, .0288, .1152, .2304};
-static const float one_high_integration_time[] = {.0288, .0576, .2304, .4608};
-static const float fifty_integration_time[] = {.0576, .1152, .4608, .9216};
-static const float twenty_integration_time[] = {.1152, .2304, .9216, 1.8432};
+static constexpr float eight_high_integration_time[] = {.0036, .0072, .0288, .0576};
+static constexpr float four_high_integration_time[] = {.0072, .0144, .0576, .1152};
+static constexpr float two_high_integration_time[] = {.0144, .0288, .1152, .2304};
+static constexpr float one_high_integration_time[] = {.0288, .0576, .2304, .4608};
+static constexpr float fifty_integration_time[] = {.0576, .1152, .4608, .9216};
+static constexpr float twenty_integration_time[] = {.1152, .2304, .9216, 1.8432};
+
+// Conversion factors for one gain and integration time setting. Both are 0 for
+// the reserved integration time encodings.
+struct veml6030_conversion {
+    float lux_per_count;
+    float counts_per_lux;
+};
+
+// This function returns the conversion factors for the gain and integration time
+// fields of a SETTING_REG value. It is a single table load, indexed by the raw
+// register bits.
+const veml6030_conversion &veml6030_conversion_for(uint16_t setting_reg);
+
+// These functions compensate lux values over 1000 with the datasheet polynomial,
+// evaluated in Horner form. The fixed point version uses only 64 bit integer
+// arithmetic, for processors without floating point hardware, and stays within
+// a few lux of the double version over the sensor's whole range (inputs are
+// clamped to 2^17 - 1 lux to keep the intermediate values in range).
+uint32_t veml6030_lux_compensation(uint32_t lux_value);
+uint32_t veml6030_lux_compensation_fixed(uint32_t lux_value);
+
+class veml6030_transport;
+
+// The outcome of a register access. status is 0 on success or a negative errno
+// value, and value is only meaningful when status is 0.
+struct veml6030_register_result {
+    int status;
+    uint16_t value;
+
+    bool ok() const {
+        return (status == 0);
+    }
+};
+
+// How hard the driver tries before giving up on a bus access. Transient errors
+// (EAGAIN, EREMOTEIO and ETIMEDOUT) are retried, backoff_ns apart, until
+// max_attempts attempts have been made or deadline_ns has passed since the first
+// failure, which bounds the time one access can take. Once
+// reopen_after_failures accesses in a row have failed (0 never), the transport
+// is reopened and the driver's configuration is written back to the sensor.
+struct veml6030_retry_policy {
+    int max_attempts;
+    int64_t backoff_ns;
+    int64_t deadline_ns;
+    int reopen_after_failures;
+};
+
+// Three attempts 1ms apart within 20ms, and recovery after 5 failed accesses.
+extern const veml6030_retry_policy veml6030_default_retry_policy;
+
+// One sample of both light channels, read together so they come from the same
+// integration period, along with the configuration used to convert them.
+struct veml6030_sample {
+    uint16_t ambient_light_bits; // Raw REG0x04 counts
+    uint16_t white_light_bits;   // Raw REG0x05 counts
+    uint8_t interrupt_status;    // NO_INT, INT_HIGH or INT_LOW (NO_INT if not read)
+    uint32_t ambient_light_lux;
+    uint32_t white_light_lux;
+    uint16_t setting_reg;        // REG0x00 in effect for the conversion
+    uint16_t power_save_reg;     // REG0x03 in effect for the conversion
+    bool settled;                // false if read while auto ranging was settling
+};
 
 class SparkFun_Ambient_Light {
   public:
-    SparkFun_Ambient_Light(int address = 0x48); // I2C Constructor
+    SparkFun_Ambient_Light(int address = 0x48); // I2C Constructor, uses /dev/i2c-1
+
+    // Constructor for a sensor reached through transport. The transport is not
+    // owned and must outlive the sensor object.
+    SparkFun_Ambient_Light(veml6030_transport *transport, int address = 0x48);
+
+    ~SparkFun_Ambient_Light();
 
+    // This function returns true if the sensor answered and was configured. If the
+    // sensor didn't answer when the object was constructed, the setup is retried.
     bool begin(void); // begin function
 
     // REG0x00, bits [12:11]
@@ -134,6 +207,15 @@ class SparkFun_Ambient_Light {
     // osciallator and signal processor to power up.
     void power_on();
 
+    // REG0x00, bit[0]
+    // This function powers up the Ambient Light Sensor without the delay. The
+    // sensor is ready power_up_delay_ms later; callers that can't block (see
+    // veml6030_async_sensor) schedule that wait themselves.
+    void start_power_on();
+
+    // Time the internal oscillator and signal processor need after power up.
+    static const unsigned int power_up_delay_ms = 4;
+
     // REG0x03, bit[0]
     // This function enables the current power save mode value and puts the Ambient
     // Light Sensor into power save mode.
@@ -162,6 +244,27 @@ class SparkFun_Ambient_Light {
     // continually sampling the sensor.
     uint8_t read_power_save_mode();
 
+    // REG0x00, bits[12:11] and bits[9:6], and REG0x03, bits[2:0]
+    // This function sets the gain, integration time and power save mode (1-4, or
+    // 0 to disable power save) together, writing each register at most once and
+    // only if it changes. It returns 0 or a negative errno value (-EINVAL for an
+    // unsupported setting). veml6030_config_solver picks the values.
+    int set_configuration(float gain_val, uint16_t integration_time, uint16_t power_save_mode);
+
+    // REG0x00, bits[9:6] and REG0x03, bits[2:0]
+    // This function returns how often the sensor produces a new light reading, in
+    // milliseconds: the integration time, plus the power save mode wait time when
+    // power save mode is enabled. It comes from the cached configuration.
+    uint32_t read_refresh_period_ms();
+
+    // The generation changes whenever a write or reload of SETTING_REG or
+    // POWER_SAVE_REG changes the conversion timing (gain, integration time, power
+    // save mode or shutdown), and the change time is the CLOCK_MONOTONIC time in
+    // nanoseconds of that write, which is when the sensor restarted its
+    // conversion cycle. Interrupt and persistence settings don't restart it.
+    uint32_t get_config_generation() const;
+    int64_t get_config_change_ns() const;
+
     // REG0x06, bits[15:14]
     // This function reads the interrupt register to see if an interrupt has been
     // triggered. There are two possible interrupts: a lower limit and upper limit
@@ -189,18 +292,68 @@ class SparkFun_Ambient_Light {
     // REG[0x04], bits[15:0]
     // This function gets the sensor's ambient light's lux value. The lux value is
     // determined based on current gain and integration time settings. If the lux
-    // value exceeds 1000 then a compensation formula is applied to it.
+    // value exceeds 1000 then a compensation formula is applied to it. If the read
+    // fails it returns 0 and get_last_status() says why; use the overload below
+    // where 0 lux has to be told apart from a failed read.
     uint32_t read_light();
 
+    // REG[0x04], bits[15:0]
+    // This function reads the ambient light's lux value into lux_value. It returns
+    // false if the read failed, in which case lux_value isn't changed.
+    bool read_light(uint32_t &lux_value);
+
     // REG[0x05], bits[15:0]
     // This function gets the sensor's ambient light's lux value. The lux value is
     // determined based on current gain and integration time settings. If the lux
-    // value exceeds 1000 then a compensation formula is applied to it.
+    // value exceeds 1000 then a compensation formula is applied to it. If the read
+    // fails it returns 0 and get_last_status() says why; use the overload below
+    // where 0 lux has to be told apart from a failed read.
     uint32_t read_white_light();
 
-  private:
-    int fd_i2c_file;
-    int slave_address;
+    // REG[0x05], bits[15:0]
+    // This function reads the white light's lux value into lux_value. It returns
+    // false if the read failed, in which case lux_value isn't changed.
+    bool read_white_light(uint32_t &lux_value);
+
+    // REG[0x04], REG[0x05] and optionally REG[0x06]
+    // This function reads both light channels (and the interrupt status if
+    // read_interrupt_status is true) in a single bus transaction and converts them
+    // with the current gain and integration time. It returns false if the read
+    // failed, in which case sample is not updated.
+    bool read_sample(veml6030_sample &sample, bool read_interrupt_status = false);
+
+    // This function fills in the lux and configuration fields of a sample whose raw
+    // light bits were read elsewhere, such as by a veml6030_bus_manager batch. It
+    // returns false if the sensor configuration isn't known.
+    bool convert_sample(veml6030_sample &sample);
+
+    // REG0x00, bits[12:11] and bits[9:6]
+    // This function turns on automatic ranging. The raw ambient light count of
+    // each converted sample is checked, and the gain and integration time are
+    // stepped to keep it between 100 and 10000 counts, or moved straight to the
+    // least sensitive range if the count saturates. Ranging follows the
+    // application note order: gain is changed first at 100ms, then the
+    // integration time. Both fields are written in a single register write, and
+    // samples are marked not settled until the first full conversion with the
+    // new range has been discarded. Note that interrupt thresholds are stored in
+    // counts, so they are not valid across range changes.
+    void enable_auto_range();
+
+    // REG0x00, bits[12:11] and bits[9:6]
+    // This function turns off automatic ranging, leaving the current range set.
+    void disable_auto_range();
+
+    // This function checks if automatic ranging is enabled.
+    bool read_auto_range_enabled();
+
+    // This function turns on the lux lookup table. The compensated lux value for
+    // all 65536 raw counts is precomputed for the current gain and integration
+    // time (256KB), so converting a reading is a single load. The table is
+    // rebuilt on the next conversion after the gain or integration time changes.
+    void enable_lux_table();
+
+    // This function turns off the lux lookup table and frees it.
+    void disable_lux_table();
 
     // This function compensates for lux values over 1000. From datasheet:
     // "Illumination values higher than 1000 lx show non-linearity. This
@@ -209,12 +362,143 @@ class SparkFun_Ambient_Light {
     uint32_t lux_compensation(uint32_t _lux_value);
 
     // The lux value of the Ambient Light sensor depends on both the gain and the
-    // integration time settings. This function determines which conversion value
-    // to use by using the bit representation of the gain as an index to look up
-    // the conversion value in the correct integration time array. It then converts
+    // integration time settings. This function looks up the conversion value with
+    // the gain and integration time bits of the setting register, then converts
     // the value and returns it.
     uint32_t calculate_lux(uint16_t _light_bits);
 
+    // This function reads a whole register from the sensor, applying the retry
+    // policy. Unlike the older accessors, failure can't be mistaken for a value.
+    veml6030_register_result read_register_checked(VEML6030_16BIT_REGISTERS read_reg);
+
+    // This function writes a whole register, applying the retry policy, and keeps
+    // the driver's copy of the configuration in step. It returns 0 or a negative
+    // errno value.
+    int write_register_checked(VEML6030_16BIT_REGISTERS write_reg, uint16_t reg_value);
+
+    // This function returns the status (0 or a negative errno value) of the last
+    // bus access, so users of the accessors that can't report failure can check.
+    int get_last_status() const;
+
+    // This function records the status (0 or a negative errno value) of an access
+    // to this sensor made outside the driver, such as a veml6030_bus_manager
+    // batch, so it counts toward recovery and get_last_status() reports it.
+    void report_access(int status);
+
+    // This function records the status of an access like report_access(), for a
+    // sensor sharing its bus with others, but doesn't recover. It returns true
+    // once recovery is due; the caller reopens the shared bus once and then calls
+    // restore_configuration() on each sensor that asked for it.
+    bool report_shared_access(int status);
+
+    // This function writes the driver's copy of the configuration back to the
+    // sensor without reopening the transport, and counts as a recovery. It
+    // returns true if the sensor is configured again. get_last_status() still
+    // reports the failure that made recovery necessary.
+    bool restore_configuration();
+
+    // These functions set and return the retry policy for bus accesses.
+    void set_retry_policy(const veml6030_retry_policy &policy);
+    const veml6030_retry_policy &get_retry_policy() const;
+
+    // This function returns the number of times the transport was reopened and
+    // the configuration written back after repeated failures.
+    unsigned long get_recoveries() const;
+
+    // These functions return the sensor's I2C address and the transport it uses.
+    int get_address() const;
+    veml6030_transport *get_transport() const;
+
+    // REG0x00 - REG0x03
+    // This function re-reads the writable registers from the sensor and compares
+    // them with the driver's cached copy. It returns true if they all matched. The
+    // cache is reloaded from the sensor either way, so it can be used to recover
+    // after the sensor has been power cycled behind the driver's back.
+    bool validate_shadow_registers();
+
+  private:
+    veml6030_transport *transport;
+    bool owns_transport;
+    int slave_address;
+    bool initialized;
+
+    // Driver copy of the writable registers (SETTING_REG through POWER_SAVE_REG).
+    // It is loaded once when the sensor is opened and updated on every successful
+    // write, so configuration reads and read-modify-writes don't touch the bus.
+    uint16_t shadow_registers[POWER_SAVE_REG + 1];
+    bool shadow_registers_valid;
+    uint32_t config_generation;
+    int64_t config_change_ns;
+
+    // Automatic ranging state. settle_until_ns is the CLOCK_MONOTONIC time before
+    // which samples still come from the old range or the first new conversion.
+    bool auto_range_enabled;
+    int auto_range_step;
+    int64_t settle_until_ns;
+
+    // This function marks samples not settled until a second full conversion with
+    // the configuration written at config_change_ns has completed.
+    void start_settling();
+
+    // This function records a write that changed write_reg from old_value to
+    // new_value. If the conversion timing changed, the generation moves on and
+    // samples settle again.
+    void configuration_written(VEML6030_16BIT_REGISTERS write_reg, uint16_t old_value, uint16_t new_value);
+
+    // Error handling state. consecutive_failures counts failed accesses since the
+    // last success; recovering is set while the configuration is being rebuilt.
+    veml6030_retry_policy retry_policy;
+    int last_status;
+    int consecutive_failures;
+    unsigned long recoveries;
+    bool recovering;
+
+    // This function runs access (which returns 0 or a negative errno value)
+    // under the retry policy and returns its final status.
+    template <typename Access>
+    int retry_access(Access access);
+
+    // This function records the final status of an access and starts recovery
+    // after too many failures in a row.
+    void finish_access(int status);
+
+    // This function reopens the transport and writes the configuration back.
+    bool recover();
+
+    // This function checks the raw count of a converted sample and changes range
+    // if it is outside the auto range band.
+    void auto_range_update(uint16_t _light_bits);
+
+    // This function sets the gain and integration time fields of SETTING_REG in
+    // one register write, to the auto range step _step.
+    void set_auto_range_step(int _step);
+
+    // Lux lookup table state. lux_table_setting holds the gain and integration
+    // time bits of SETTING_REG the table was built for.
+    bool lux_table_enabled;
+    bool lux_table_valid;
+    uint16_t lux_table_setting;
+    std::vector<uint32_t> lux_table;
+
+    // This function fills the lux lookup table for the gain and integration time
+    // bits of _setting_reg.
+    void build_lux_table(uint16_t _setting_reg);
+
+    // This function loads the shadow registers from the sensor. It returns false if
+    // any of the reads failed, in which case the shadow is left marked invalid.
+    bool load_shadow_registers();
+
+    // This function loads the shadow registers and applies the default power, gain
+    // and integration time settings. It returns false if the sensor didn't answer.
+    bool initialize();
+
+    SparkFun_Ambient_Light(const SparkFun_Ambient_Light &) = delete;
+    SparkFun_Ambient_Light &operator=(const SparkFun_Ambient_Light &) = delete;
+
+    // This function converts a raw light channel count to lux, applying the
+    // compensation formula above 1000 lux.
+    uint32_t light_bits_to_lux(uint16_t _light_bits);
+
     // This function does the opposite calculation then the function above. The interrupt
     // threshold values given by the user are dependent on the gain and
     // intergration time settings. As a result the lux value needs to be
@@ -225,9 +509,13 @@ class SparkFun_Ambient_Light {
     // This function reads a 16 bit register. It takes the register's address as its' parameter.
     uint16_t raw_read_register(VEML6030_16BIT_REGISTERS read_reg);
 
-    // This function writes to a 16 bit register. Paramaters include the register's address,
-    // the value to write, and the register value.
-    void raw_write_register(VEML6030_16BIT_REGISTERS write_reg, uint16_t output_reg_value);
+    // This function reads a 16 bit register into reg_value, applying the retry
+    // policy. It returns false if the read failed.
+    bool raw_read_register(VEML6030_16BIT_REGISTERS read_reg, uint16_t &reg_value);
+
+    // This function writes to a 16 bit register, applying the retry policy. Paramaters
+    // include the register's address and the register value. It returns false if the write failed.
+    bool raw_write_register(VEML6030_16BIT_REGISTERS write_reg, uint16_t output_reg_value);
 
     // This function reads a 16 bit register, then shifts and masks the value before returning it.
     // A negative count is a left logical shift. A positive count is a right logical shift.
@@ -2,6 +2,7 @@
 #include "./ui_display_i2c_light_sensor.h"
 #include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
 #include <QDebug>
+#include <QMessageBox>
 #include <QTimer>
 #include <QDateTime>
 #include <QtCore/QDateTime>
@@ -9,17 +10,67 @@
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QDateTimeAxis>
 #include <QtCharts/QValueAxis>
-#include <limits>
 
-display_i2c_light_sensor::display_i2c_light_sensor(QWidget *parent)
+// Smoothing applied with --smooth: readings more than 3.5 standard deviations
+// from the median of the last 15 are dropped, and the rest averaged over about
+// half a second. Both are independent of the light level and sample rate.
+static const size_t outlier_window_size = 15;
+static const double outlier_threshold = 3.5;
+static const int64_t smoothing_time_constant_ns = 500000000;
+
+display_i2c_light_sensor::display_i2c_light_sensor(const QString &capture_file_name,
+                                                   const QString &replay_file_name, double replay_speed,
+                                                   unsigned int max_frames_per_second, bool smooth,
+                                                   QWidget *parent)
     : QMainWindow(parent),
       ui(new Ui::display_i2c_light_sensor),
-      light_sensor(),
-      update_light_timer() {
+      light_sensor(nullptr),
+      capture(),
+      acquisition(nullptr),
+      replay(),
+      sample_source(nullptr),
+      update_light_timer(),
+      render_scheduler(max_frames_per_second),
+      smooth(smooth),
+      outlier_filter(outlier_window_size, outlier_threshold),
+      smoothing_filter(smoothing_time_constant_ns),
+      filter_pipeline(),
+      history(),
+      axis_min_reading(0),
+      axis_max_reading(0) {
     QMainWindow *my_main_window;
 
     my_main_window = this;
     ui->setupUi(this);
+    filter_pipeline.add_stage(&outlier_filter);
+    filter_pipeline.add_stage(&smoothing_filter);
+    epoch_ms_offset = veml6030_monotonic_to_epoch_ms_offset();
+    /* The sensor is only opened for live readings; opening it configures it. */
+    if (!replay_file_name.isEmpty()) {
+        sample_source = &replay;
+        if (replay.open(replay_file_name.toLocal8Bit().constData(), replay_speed)) {
+            epoch_ms_offset = replay.get_epoch_ms_offset();
+        } else {
+            QMessageBox replay_open_msg;
+            replay_open_msg.setText("Couldn't open the replay file " + replay_file_name + ".");
+            replay_open_msg.exec();
+        }
+        if (!capture_file_name.isEmpty()) {
+            QMessageBox capture_ignored_msg;
+            capture_ignored_msg.setText("Nothing is captured while replaying, so " + capture_file_name +
+                                        " isn't written.");
+            capture_ignored_msg.exec();
+        }
+    } else {
+        light_sensor = new SparkFun_Ambient_Light();
+        acquisition = new veml6030_acquisition(light_sensor);
+        sample_source = acquisition;
+        if (!light_sensor->begin()) {
+            QMessageBox sensor_open_msg;
+            sensor_open_msg.setText("Couldn't open the light sensor on the i2c bus.");
+            sensor_open_msg.exec();
+        }
+    }
     series = new QLineSeries();
     light_chart = new QChart();
     light_chart_view = new QChartView(light_chart);
@@ -28,7 +79,7 @@ display_i2c_light_sensor::display_i2c_light_sensor(QWidget *parent)
     light_chart->setTitle("Ambient Light detector values.");
     light_chart_view->setRenderHint(QPainter::Antialiasing);
     connect(&update_light_timer, SIGNAL(timeout()), this, SLOT(update_ambient_light()));
-    update_light_timer.start(1000*10);
+    update_light_timer.start(render_scheduler.get_frame_interval_ms());
     my_main_window->setCentralWidget(light_chart_view);
 
     axisX = new QDateTimeAxis;
@@ -43,34 +94,103 @@ display_i2c_light_sensor::display_i2c_light_sensor(QWidget *parent)
     light_chart->addAxis(axisY, Qt::AlignLeft);
     series->attachAxis(axisY);
 
-    min_reading = std::numeric_limits<qreal>::max();
-    max_reading = std::numeric_limits<qreal>::min();
+    axisY->setRange(axis_min_reading, axis_max_reading);
+
+    if ((acquisition != nullptr) && !capture_file_name.isEmpty()) {
+        if (capture.open(capture_file_name.toLocal8Bit().constData())) {
+            acquisition->set_capture(&capture);
+        } else {
+            QMessageBox capture_open_msg;
+            capture_open_msg.setText("Couldn't open the capture file " + capture_file_name + ".");
+            capture_open_msg.exec();
+        }
+    }
+
+    sample_source->start();
 }
 
+// This function runs once per frame interval. Samples are collected on every
+// tick, which is cheap, but the chart is only redrawn when the render scheduler
+// says a frame is due, so the drawing cost doesn't depend on the sample rate.
 void display_i2c_light_sensor::update_ambient_light(void) {
-    uint32_t light_reading;
-    double output_light_reading;
+    int64_t now_ns;
+
+    render_scheduler.samples_arrived(collect_samples());
+    now_ns = veml6030_monotonic_ns();
+    if (render_scheduler.frame_due(now_ns)) {
+        render_chart();
+        render_scheduler.frame_rendered(now_ns);
+    }
+}
 
-    light_reading = light_sensor.read_light();
-    output_light_reading = light_reading;
-    if (light_reading < min_reading) {
-        min_reading = light_reading;
+// This function moves the queued samples into the rollup history, through the
+// filter pipeline if smoothing is on. It doesn't touch the chart.
+size_t display_i2c_light_sensor::collect_samples(void) {
+    static const size_t drain_batch_size = 64;
+    veml6030_timed_sample samples[drain_batch_size];
+    veml6030_filter_point points[drain_batch_size];
+    size_t sample_count;
+    size_t collected = 0;
+
+    while ((sample_count = sample_source->drain(samples, drain_batch_size)) > 0) {
+        for (size_t i = 0; i < sample_count; ++i) {
+            points[i].timestamp_ns = samples[i].timestamp_ns;
+            points[i].value = samples[i].sample.ambient_light_lux;
+            points[i].valid = true;
+        }
+        if (smooth) {
+            filter_pipeline.process(points, sample_count);
+        }
+        for (size_t i = 0; i < sample_count; ++i) {
+            qint64 sample_time_ms = (points[i].timestamp_ns / 1000000) + epoch_ms_offset;
+
+            if (points[i].valid) {
+                history.append(sample_time_ms, points[i].value);
+            }
+        }
+        collected += sample_count;
     }
-    if (light_reading > max_reading) {
-        max_reading = light_reading * 1.5;
+    return collected;
+}
+
+// This function redraws the chart with everything the history still covers,
+// taken from the rollup tier that fits the plot's width, with one replace()
+// call and at most one range change per axis. The cost doesn't depend on how
+// long the display has been running.
+void display_i2c_light_sensor::render_chart(void) {
+    size_t bucket_count;
+    int64_t start_ms;
+    int64_t end_ms;
+
+    if (history.empty()) {
+        return;
     }
-    if (series->count() == 0) {
-        axisX->setMin(QDateTime::currentDateTime());
-        axisY->setMin(0);
-    } else {
-        axisY->setMin(min_reading);
-        axisY->setMax(max_reading);
+    bucket_count = (size_t)light_chart->plotArea().width();
+    if (bucket_count < 1) {
+        bucket_count = 1;
+    }
+    start_ms = history.oldest_ms();
+    end_ms = history.newest_ms();
+    history.query(start_ms, end_ms, bucket_count, visible_points);
+    if (visible_points.empty()) {
+        return;
+    }
+    plotted_points.resize(visible_points.size());
+    for (size_t i = 0; i < visible_points.size(); ++i) {
+        plotted_points[i] = QPointF(visible_points[i].time_ms, visible_points[i].value);
+    }
+    series->replace(plotted_points);
+    axisX->setRange(QDateTime::fromMSecsSinceEpoch(start_ms), QDateTime::fromMSecsSinceEpoch(end_ms));
+    /* The window extrema cover exactly the span queried, which is what's shown. */
+    if (veml6030_axis_range_update(history.min_value(), history.max_value(), axis_min_reading,
+                                   axis_max_reading)) {
+        axisY->setRange(axis_min_reading, axis_max_reading);
     }
-    series->append(QDateTime::currentDateTime().toMSecsSinceEpoch(), output_light_reading);
-    axisX->setMax(QDateTime::currentDateTime());
-    axisY->setMax(light_reading);
 }
 
 display_i2c_light_sensor::~display_i2c_light_sensor() {
+    sample_source->stop();
+    delete acquisition;
+    delete light_sensor;
     delete ui;
 }
@@ -10,9 +10,15 @@
 #include <QtCharts/QValueAxis>
 #include <QtCharts/QDateTimeAxis>
 using namespace QtCharts;
-#include <linux/i2c-dev.h>
-#include <i2c/smbus.h>
 #include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_acquisition.h"
+#include "veml6030_capture.h"
+#include "veml6030_replay.h"
+#include "veml6030_rollup.h"
+#include "veml6030_window_extrema.h"
+#include "veml6030_render_scheduler.h"
+#include "veml6030_filter.h"
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -24,14 +30,43 @@ class display_i2c_light_sensor : public QMainWindow {
     Q_OBJECT
 
   public:
-    display_i2c_light_sensor(QWidget *parent = nullptr);
+    // If capture_file_name isn't empty, every sample is also appended to that capture file.
+    // If replay_file_name isn't empty, that capture file is replayed at replay_speed
+    // times real time (0 for as fast as possible) instead of reading the sensor; the
+    // sensor isn't opened at all then, and nothing is captured.
+    // The chart is redrawn at most max_frames_per_second times a second. If smooth
+    // is true, outliers are dropped and the readings smoothed before they are shown.
+    display_i2c_light_sensor(const QString &capture_file_name = QString(),
+                             const QString &replay_file_name = QString(), double replay_speed = 1.0,
+                             unsigned int max_frames_per_second =
+                                 veml6030_render_scheduler::default_frames_per_second,
+                             bool smooth = false, QWidget *parent = nullptr);
     ~display_i2c_light_sensor();
   public slots:
     void update_ambient_light(void);
   private:
+    // This function moves the queued samples into the history. It returns how many were moved.
+    size_t collect_samples(void);
+
+    // This function commits the history to the chart.
+    void render_chart(void);
+
     Ui::display_i2c_light_sensor *ui;
-    SparkFun_Ambient_Light light_sensor;
+    SparkFun_Ambient_Light *light_sensor; // Only opened for live readings
+    veml6030_capture_writer capture;
+    veml6030_acquisition *acquisition;
+    veml6030_replay replay;
+    veml6030_sample_source *sample_source;
+    int64_t epoch_ms_offset;
     QTimer update_light_timer;
+    veml6030_render_scheduler render_scheduler;
+    bool smooth;
+    veml6030_outlier_filter outlier_filter;
+    veml6030_ema_filter smoothing_filter;
+    veml6030_filter_pipeline filter_pipeline;
+    veml6030_rollup_store history;
+    std::vector<veml6030_chart_point> visible_points;
+    QVector<QPointF> plotted_points;
     QLineSeries *series;
     QChart *light_chart;
     QChartView *light_chart_view;
@@ -39,7 +74,7 @@ class display_i2c_light_sensor : public QMainWindow {
     QValueAxis *axisY;
     QDateTime min_time;
     QDateTime max_time;
-    qreal min_reading;
-    qreal max_reading;
+    double axis_min_reading;
+    double axis_max_reading;
 };
 #endif // DISPLAY_I2C_LIGHT_SENSOR_H
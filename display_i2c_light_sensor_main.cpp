@@ -1,11 +1,49 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <stdio.h>
 #include "display_i2c_light_sensor.h"
 
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
-    display_i2c_light_sensor w;
+    QCommandLineParser parser;
+    QCommandLineOption capture_option("capture", "Append the raw sensor samples to <file>.", "file");
+    QCommandLineOption replay_option("replay", "Replay the capture <file> instead of reading the sensor.", "file");
+    QCommandLineOption speed_option("speed", "Replay at <factor> times real time, 0 for as fast as possible.",
+                                    "factor", "1");
+    QCommandLineOption max_fps_option("max-fps", "Redraw the chart at most <rate> times a second.", "rate",
+                                      QString::number(veml6030_render_scheduler::default_frames_per_second));
+    QCommandLineOption smooth_option("smooth", "Drop outliers and smooth the readings before charting them.");
+    unsigned int max_frames_per_second;
+    bool value_ok;
+    double replay_speed;
     int app_return_code;
 
+    parser.setApplicationDescription("Display the VEML6030 ambient light sensor readings.");
+    parser.addHelpOption();
+    parser.addOption(capture_option);
+    parser.addOption(replay_option);
+    parser.addOption(speed_option);
+    parser.addOption(max_fps_option);
+    parser.addOption(smooth_option);
+    parser.process(a);
+
+    if (parser.isSet(capture_option) && parser.isSet(replay_option)) {
+        fprintf(stderr, "--capture can't be used with --replay.\n");
+        return 1;
+    }
+    replay_speed = parser.value(speed_option).toDouble(&value_ok);
+    if (!value_ok || (replay_speed < 0)) {
+        fprintf(stderr, "Invalid replay speed %s.\n", qPrintable(parser.value(speed_option)));
+        return 1;
+    }
+    max_frames_per_second = parser.value(max_fps_option).toUInt(&value_ok);
+    if (!value_ok || (max_frames_per_second == 0)) {
+        fprintf(stderr, "Invalid frame rate %s.\n", qPrintable(parser.value(max_fps_option)));
+        return 1;
+    }
+    display_i2c_light_sensor w(parser.value(capture_option), parser.value(replay_option), replay_speed,
+                               max_frames_per_second, parser.isSet(smooth_option));
+
     w.show();
     app_return_code = a.exec();
     return app_return_code;
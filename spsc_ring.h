@@ -0,0 +1,69 @@
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <stddef.h>
+#include <atomic>
+
+// Fixed capacity, allocation free, lock free ring buffer for exactly one
+// producer thread and one consumer thread. Capacity must be a power of two.
+// The head and tail indexes are kept on separate cache lines so the producer
+// and consumer don't bounce a line between them on every element.
+template <typename T, size_t Capacity>
+class spsc_ring {
+    static_assert((Capacity >= 2) && ((Capacity & (Capacity - 1)) == 0),
+                  "spsc_ring capacity must be a power of two");
+
+  public:
+    spsc_ring() : head(0), tail(0) {}
+
+    // Producer side. This function returns false (and drops value) if the ring is full.
+    bool push(const T &value) {
+        size_t current_head = head.load(std::memory_order_relaxed);
+
+        if ((current_head - tail.load(std::memory_order_acquire)) == Capacity) {
+            return false;
+        }
+        elements[current_head & (Capacity - 1)] = value;
+        head.store(current_head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. This function returns false if the ring is empty.
+    bool pop(T &value) {
+        return (pop_batch(&value, 1) == 1);
+    }
+
+    // Consumer side. This function moves up to max_count elements into values and
+    // returns how many were moved. The whole batch costs one acquire and one release.
+    size_t pop_batch(T *values, size_t max_count) {
+        size_t current_tail = tail.load(std::memory_order_relaxed);
+        size_t available = head.load(std::memory_order_acquire) - current_tail;
+
+        if (available > max_count) {
+            available = max_count;
+        }
+        for (size_t i = 0; i < available; ++i) {
+            values[i] = elements[(current_tail + i) & (Capacity - 1)];
+        }
+        tail.store(current_tail + available, std::memory_order_release);
+        return available;
+    }
+
+    // Either side. This function returns an estimate of the number of queued elements.
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() {
+        return Capacity;
+    }
+
+  private:
+    alignas(64) std::atomic<size_t> head; // Written by the producer only
+    alignas(64) std::atomic<size_t> tail; // Written by the consumer only
+    alignas(64) T elements[Capacity];
+
+    spsc_ring(const spsc_ring &) = delete;
+    spsc_ring &operator=(const spsc_ring &) = delete;
+};
+#endif
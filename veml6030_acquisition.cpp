@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "veml6030_acquisition.h"
+#include "veml6030_conversion_scheduler.h"
+#include "veml6030_capture.h"
+
+veml6030_acquisition::veml6030_acquisition(SparkFun_Ambient_Light *sensor, unsigned int sample_period_ms)
+    : sensor(sensor),
+      sample_period_ms(sample_period_ms),
+      dropped(0),
+      failures(0),
+      capture(NULL) {
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        perror("eventfd() in veml6030_acquisition");
+    }
+}
+
+veml6030_acquisition::~veml6030_acquisition() {
+    stop();
+    if (stop_fd >= 0) {
+        close(stop_fd);
+    }
+}
+
+void veml6030_acquisition::set_capture(veml6030_capture_writer *capture) {
+    this->capture = capture;
+}
+
+void veml6030_acquisition::start() {
+    uint64_t stop_count;
+
+    if (acquisition_thread.joinable() || (stop_fd < 0)) {
+        return;
+    }
+    /* Clear any stop request left from a previous run. */
+    if (read(stop_fd, &stop_count, sizeof(stop_count)) < 0) {
+        stop_count = 0;
+    }
+    acquisition_thread = std::thread(&veml6030_acquisition::run, this);
+}
+
+void veml6030_acquisition::stop() {
+    uint64_t stop_count = 1;
+
+    if (!acquisition_thread.joinable()) {
+        return;
+    }
+    if (write(stop_fd, &stop_count, sizeof(stop_count)) < 0) {
+        perror("write() of stop request in veml6030_acquisition");
+    }
+    acquisition_thread.join();
+    /* Make the partly filled capture block visible to readers. */
+    if (capture != NULL) {
+        capture->flush();
+    }
+}
+
+size_t veml6030_acquisition::drain(veml6030_timed_sample *samples, size_t max_count) {
+    return this->samples.pop_batch(samples, max_count);
+}
+
+unsigned long veml6030_acquisition::dropped_samples() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+unsigned long veml6030_acquisition::failed_reads() const {
+    return failures.load(std::memory_order_relaxed);
+}
+
+// This function stamps a sample and queues it. Samples read while auto ranging is
+// settling are from the old range and are dropped.
+void veml6030_acquisition::queue_sample(const veml6030_sample &sample, uint32_t sequence) {
+    veml6030_timed_sample timed_sample;
+
+    if (!sample.settled) {
+        return;
+    }
+
+    timed_sample.timestamp_ns = veml6030_monotonic_ns();
+    timed_sample.sequence = sequence;
+    timed_sample.sample = sample;
+    if (capture != NULL) {
+        capture->append(timed_sample);
+    }
+    if (!samples.push(timed_sample)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// This function is the body of the sampling thread. It sleeps in poll() on a
+// timerfd and the stop eventfd. With a fixed period the timerfd is a periodic
+// timer, whose expirations stay on the schedule it was armed with, so a slow
+// read doesn't make the rate drift; the sequence number advances by the number
+// of expirations, so periods missed by a slow read leave a gap. Otherwise it is
+// the conversion scheduler's timer.
+void veml6030_acquisition::run() {
+    veml6030_conversion_scheduler scheduler(sensor);
+    struct pollfd wait_fds[2];
+    int periodic_fd = -1;
+    uint32_t sequence = 0;
+
+    wait_fds[0].fd = stop_fd;
+    wait_fds[0].events = POLLIN;
+    wait_fds[1].events = POLLIN;
+    if (sample_period_ms == 0) {
+        wait_fds[1].fd = scheduler.get_fd();
+    } else {
+        struct itimerspec timer_setting;
+
+        periodic_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (periodic_fd < 0) {
+            perror("timerfd_create() in veml6030_acquisition");
+            return;
+        }
+        timer_setting.it_interval.tv_sec = sample_period_ms / 1000;
+        timer_setting.it_interval.tv_nsec = (sample_period_ms % 1000) * 1000000;
+        timer_setting.it_value.tv_sec = 0;
+        timer_setting.it_value.tv_nsec = 1;
+        timerfd_settime(periodic_fd, 0, &timer_setting, NULL);
+        wait_fds[1].fd = periodic_fd;
+    }
+
+    for (;;) {
+        uint64_t expirations;
+        veml6030_sample sample;
+
+        if (poll(wait_fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll() in veml6030_acquisition");
+            break;
+        }
+        if (wait_fds[0].revents & POLLIN) {
+            break;
+        }
+        if (!(wait_fds[1].revents & POLLIN)) {
+            continue;
+        }
+        if (read(wait_fds[1].fd, &expirations, sizeof(expirations)) < 0) {
+            continue;
+        }
+        if (periodic_fd >= 0) {
+            sequence += (uint32_t)expirations;
+            if (sensor->read_sample(sample)) {
+                queue_sample(sample, sequence);
+            } else {
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            unsigned long skipped_before = scheduler.skipped_polls();
+
+            if (scheduler.poll(sample, sequence)) {
+                queue_sample(sample, sequence);
+            } else if (scheduler.skipped_polls() == skipped_before) {
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    if (periodic_fd >= 0) {
+        close(periodic_fd);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef _VEML6030_ACQUISITION_H_
+#define _VEML6030_ACQUISITION_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_clock.h"
+#include "spsc_ring.h"
+
+class veml6030_capture_writer;
+
+// A sensor sample stamped with the CLOCK_MONOTONIC time it was read. When
+// sampling each conversion, the sequence number counts sensor conversions and a
+// gap means conversions were missed. When sampling at a fixed period it counts
+// periods instead, and a gap means periods passed without a sample (a late or
+// failed read); it says nothing about the sensor's conversions.
+struct veml6030_timed_sample {
+    int64_t timestamp_ns;
+    uint32_t sequence;
+    veml6030_sample sample;
+};
+
+// Something that produces timestamped samples on its own thread for a consumer
+// to drain, either a live sensor or a recording being replayed.
+class veml6030_sample_source {
+  public:
+    static const size_t ring_capacity = 1024;
+    typedef spsc_ring<veml6030_timed_sample, ring_capacity> sample_ring;
+
+    virtual ~veml6030_sample_source() {}
+
+    // These functions start and stop the producing thread.
+    virtual void start() = 0;
+    virtual void stop() = 0;
+
+    // Consumer side. This function moves up to max_count queued samples into
+    // samples and returns how many were moved.
+    virtual size_t drain(veml6030_timed_sample *samples, size_t max_count) = 0;
+
+    // Number of samples dropped because the ring was full.
+    virtual unsigned long dropped_samples() const = 0;
+};
+
+// Samples one sensor on a dedicated thread and queues timestamped samples in a
+// fixed capacity lock free ring. The consumer (usually the GUI thread) drains
+// the ring in batches, so a slow or failing bus transaction never blocks it.
+// Once started, the sensor must only be used by the acquisition thread.
+class veml6030_acquisition : public veml6030_sample_source {
+  public:
+    // A sample_period_ms of 0 reads each sensor conversion once, as soon as it
+    // completes (see veml6030_conversion_scheduler). Otherwise the sensor is read
+    // every sample_period_ms, and sequence numbers count periods.
+    veml6030_acquisition(SparkFun_Ambient_Light *sensor, unsigned int sample_period_ms = 0);
+    ~veml6030_acquisition();
+
+    // This function makes the sampling thread also append every queued sample to
+    // capture (NULL for none). It must be called before start().
+    void set_capture(veml6030_capture_writer *capture);
+
+    // These functions start and stop the sampling thread.
+    void start();
+    void stop();
+
+    // Consumer side. This function moves up to max_count queued samples into
+    // samples and returns how many were moved.
+    size_t drain(veml6030_timed_sample *samples, size_t max_count);
+
+    // Number of samples dropped because the ring was full, and the number of
+    // sensor reads that failed.
+    unsigned long dropped_samples() const;
+    unsigned long failed_reads() const;
+
+  private:
+    SparkFun_Ambient_Light *sensor;
+    unsigned int sample_period_ms;
+    std::atomic<unsigned long> dropped;
+    std::atomic<unsigned long> failures;
+    sample_ring samples;
+    veml6030_capture_writer *capture;
+
+    std::thread acquisition_thread;
+    int stop_fd;
+
+    // This function is the body of the sampling thread.
+    void run();
+
+    // This function stamps a sample and queues it.
+    void queue_sample(const veml6030_sample &sample, uint32_t sequence);
+
+    veml6030_acquisition(const veml6030_acquisition &) = delete;
+    veml6030_acquisition &operator=(const veml6030_acquisition &) = delete;
+};
+#endif
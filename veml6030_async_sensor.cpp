@@ -0,0 +1,178 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "veml6030_async_sensor.h"
+#include "veml6030_retry.h"
+#include "veml6030_transport.h"
+
+veml6030_async_sensor::veml6030_async_sensor(veml6030_executor &executor, SparkFun_Ambient_Light *sensor)
+    : executor(executor),
+      sensor(sensor),
+      scheduler(sensor),
+      repeating(false),
+      watching(false),
+      power_timer(0),
+      retry_timer(0),
+      retry_policy(sensor->get_retry_policy()) {
+    veml6030_retry_policy single_attempt = retry_policy;
+
+    single_attempt.max_attempts = 1;
+    sensor->set_retry_policy(single_attempt);
+    power_retry.attempt = 1;
+    power_retry.first_failure_ns = 0;
+    read_retry = power_retry;
+}
+
+veml6030_async_sensor::~veml6030_async_sensor() {
+    watch_conversions(false);
+    if (power_timer != 0) {
+        executor.cancel(power_timer);
+    }
+    if (retry_timer != 0) {
+        executor.cancel(retry_timer);
+    }
+    sensor->set_retry_policy(retry_policy);
+}
+
+SparkFun_Ambient_Light *veml6030_async_sensor::get_sensor() const {
+    return sensor;
+}
+
+void veml6030_async_sensor::power_on(done_callback done) {
+    if (power_timer != 0) {
+        executor.cancel(power_timer);
+    }
+    power_retry.attempt = 1;
+    power_on_attempt(done);
+}
+
+// This function writes the power bit and leaves the power up delay, or the
+// back-off before another attempt, to an executor timer instead of sleeping.
+void veml6030_async_sensor::power_on_attempt(done_callback done) {
+    int status;
+    bool ok;
+
+    sensor->start_power_on();
+    status = sensor->get_last_status();
+    if ((status < 0) && retry_due(status, power_retry)) {
+        power_timer = executor.call_after(retry_policy.backoff_ns, [this, done]() {
+            power_timer = 0;
+            power_on_attempt(done);
+        });
+        return;
+    }
+    ok = (status == 0);
+    power_timer = executor.call_after((int64_t)SparkFun_Ambient_Light::power_up_delay_ms * 1000000, [this, done, ok]() {
+        power_timer = 0;
+        done(ok);
+    });
+}
+
+// This function applies the retry policy the way veml6030_retry_access() does,
+// but leaves the back-off to the caller's executor timer.
+bool veml6030_async_sensor::retry_due(int status, retry_state &retry) {
+    int64_t now_ns;
+
+    if (!veml6030_is_transient_error(status) || (retry.attempt >= retry_policy.max_attempts)) {
+        return false;
+    }
+    now_ns = veml6030_monotonic_ns();
+    if (retry.attempt == 1) {
+        retry.first_failure_ns = now_ns;
+    }
+    if ((now_ns + retry_policy.backoff_ns - retry.first_failure_ns) > retry_policy.deadline_ns) {
+        return false;
+    }
+    ++retry.attempt;
+    sensor->get_transport()->get_stats().record_retry();
+    return true;
+}
+
+void veml6030_async_sensor::read_next(sample_callback done) {
+    pending_read = done;
+    repeating = false;
+    watch_conversions(true);
+}
+
+void veml6030_async_sensor::start_sampling(sample_callback each) {
+    pending_read = each;
+    repeating = true;
+    watch_conversions(true);
+}
+
+void veml6030_async_sensor::stop_sampling() {
+    pending_read = nullptr;
+    repeating = false;
+    watch_conversions(false);
+    if (retry_timer != 0) {
+        executor.cancel(retry_timer);
+        retry_timer = 0;
+    }
+}
+
+void veml6030_async_sensor::watch_conversions(bool watch) {
+    if (watch == watching) {
+        return;
+    }
+    if (watch) {
+        watching = executor.watch_fd(scheduler.get_fd(), EPOLLIN, [this](uint32_t events) {
+            conversion_ready(events);
+        });
+    } else {
+        executor.unwatch_fd(scheduler.get_fd());
+        watching = false;
+    }
+}
+
+// This function is called when the scheduler's timer expires. A retry still
+// waiting for an earlier conversion is dropped; this read supersedes it.
+void veml6030_async_sensor::conversion_ready(uint32_t events) {
+    uint64_t expirations;
+
+    (void)events;
+    if (read(scheduler.get_fd(), &expirations, sizeof(expirations)) < 0) {
+        expirations = 0;
+    }
+    if (retry_timer != 0) {
+        executor.cancel(retry_timer);
+        retry_timer = 0;
+    }
+    read_retry.attempt = 1;
+    read_attempt();
+}
+
+// This function reads the conversion the timer announced. The scheduler drops
+// the poll without a bus access if the timer fired early (it was still on the
+// old period after a configuration change); that isn't reported. A failed read
+// leaves the conversion unread, so a retry reads the same one.
+void veml6030_async_sensor::read_attempt() {
+    veml6030_sample sample;
+    uint32_t sequence = 0;
+    unsigned long skipped = scheduler.skipped_polls();
+    sample_callback done;
+    bool ok;
+
+    ok = scheduler.poll(sample, sequence);
+    if (!ok && (scheduler.skipped_polls() != skipped)) {
+        return;
+    }
+    if (!ok && retry_due(sensor->get_last_status(), read_retry)) {
+        retry_timer = executor.call_after(retry_policy.backoff_ns, [this]() {
+            retry_timer = 0;
+            read_attempt();
+        });
+        return;
+    }
+    /* The callback may start another read or destroy this object. */
+    if (repeating) {
+        done = pending_read;
+    } else {
+        done.swap(pending_read);
+        watch_conversions(false);
+    }
+    if (done) {
+        done(ok, sample, sequence);
+    }
+}
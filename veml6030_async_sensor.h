@@ -0,0 +1,86 @@
+#ifndef _VEML6030_ASYNC_SENSOR_H_
+#define _VEML6030_ASYNC_SENSOR_H_
+
+#include <stdint.h>
+#include <functional>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_conversion_scheduler.h"
+#include "veml6030_executor.h"
+
+// Non-blocking operations on one sensor, run by a veml6030_executor. The power up
+// delay, the wait for each conversion and the back-off between retries are
+// executor timers rather than sleeps, so one thread can drive any number of
+// sensors; only the register accesses themselves touch the bus synchronously.
+//
+// The sensor's retry policy is taken over when this object is constructed: the
+// driver is left making single attempts (recovery after repeated failures still
+// happens, without sleeping) and the retries are scheduled here instead. The
+// policy is given back to the sensor on destruction.
+//
+// Reads are paced by a veml6030_conversion_scheduler whose timerfd is watched by
+// the executor, so each conversion is read once, just after it completes.
+// Callbacks run on the executor's thread. The sensor and executor must outlive
+// this object.
+class veml6030_async_sensor {
+  public:
+    typedef std::function<void(bool ok)> done_callback;
+    typedef std::function<void(bool ok, const veml6030_sample &sample, uint32_t sequence)> sample_callback;
+
+    veml6030_async_sensor(veml6030_executor &executor, SparkFun_Ambient_Light *sensor);
+    ~veml6030_async_sensor();
+
+    // This function powers the sensor up and calls done once the power up delay
+    // has passed. ok is false if the power bit couldn't be written.
+    void power_on(done_callback done);
+
+    // This function calls done with the next conversion once it completes. ok is
+    // false if the read failed. A later call replaces an unfinished one.
+    void read_next(sample_callback done);
+
+    // This function calls each with every conversion until stop_sampling().
+    void start_sampling(sample_callback each);
+    void stop_sampling();
+
+    SparkFun_Ambient_Light *get_sensor() const;
+
+  private:
+    veml6030_executor &executor;
+    SparkFun_Ambient_Light *sensor;
+    veml6030_conversion_scheduler scheduler;
+    sample_callback pending_read;
+    bool repeating;
+    bool watching;
+    veml6030_executor::timer_id power_timer;
+    veml6030_executor::timer_id retry_timer;
+
+    // Progress of the retries of one operation under retry_policy.
+    struct retry_state {
+        int attempt;
+        int64_t first_failure_ns;
+    };
+
+    veml6030_retry_policy retry_policy;
+    retry_state power_retry;
+    retry_state read_retry;
+
+    // This function decides whether an access that failed with status should be
+    // tried again. If so it counts the retry and returns true, and the caller
+    // schedules the next attempt backoff_ns later.
+    bool retry_due(int status, retry_state &retry);
+
+    // This function writes the power bit, retrying on transient errors.
+    void power_on_attempt(done_callback done);
+
+    // This function reads the completed conversion, retrying on transient errors.
+    void read_attempt();
+
+    // This function watches or unwatches the scheduler's timerfd.
+    void watch_conversions(bool watch);
+
+    // This function is called by the executor when the scheduler's timer expires.
+    void conversion_ready(uint32_t events);
+
+    veml6030_async_sensor(const veml6030_async_sensor &) = delete;
+    veml6030_async_sensor &operator=(const veml6030_async_sensor &) = delete;
+};
+#endif
@@ -0,0 +1,220 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "veml6030_batch_convert.h"
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VEML6030_X86_KERNELS
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define VEML6030_NEON_KERNEL
+#endif
+
+// Datasheet compensation polynomial coefficients, applied in the same Horner
+// order as veml6030_lux_compensation() so the vector kernels match it exactly.
+static const double compensation_a4 = .00000000000060135;
+static const double compensation_a3 = -.0000000093924;
+static const double compensation_a2 = .000081488;
+static const double compensation_a1 = 1.0023;
+static const uint32_t compensation_threshold = 1000;
+
+typedef void (*convert_kernel)(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                               float lux_per_count);
+
+// This function converts the counts one at a time. It also finishes the tail of
+// the arrays for the vector kernels.
+static void convert_scalar(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                           float lux_per_count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t lux_value = (lux_per_count * light_bits[i]);
+
+        if (lux_value > compensation_threshold) {
+            lux_value = veml6030_lux_compensation(lux_value);
+        }
+        lux_values[i] = lux_value;
+    }
+}
+
+#ifdef VEML6030_X86_KERNELS
+// The linear lux value is at most 65535 * 1.8432 and the compensated value about
+// 1.13e8, so both fit the signed 32 bit conversions used below.
+
+// This function applies the compensation polynomial to two lux values in doubles.
+static inline __m128d compensate_sse2(__m128d x) {
+    __m128d term = _mm_mul_pd(x, _mm_set1_pd(compensation_a4));
+
+    term = _mm_add_pd(_mm_set1_pd(compensation_a3), term);
+    term = _mm_mul_pd(x, term);
+    term = _mm_add_pd(_mm_set1_pd(compensation_a2), term);
+    term = _mm_mul_pd(x, term);
+    term = _mm_add_pd(_mm_set1_pd(compensation_a1), term);
+    return _mm_mul_pd(x, term);
+}
+
+// This function converts 8 counts per iteration with SSE2, which every x86-64
+// processor has. Groups with no value above 1000 lux skip the polynomial.
+static void convert_sse2(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                         float lux_per_count) {
+    const __m128 factor = _mm_set1_ps(lux_per_count);
+    const __m128i threshold = _mm_set1_epi32(compensation_threshold);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        __m128i bits = _mm_loadu_si128((const __m128i *)(light_bits + i));
+        __m128i lux[2];
+
+        lux[0] = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(bits, zero)), factor));
+        lux[1] = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(bits, zero)), factor));
+        for (int half = 0; half < 2; ++half) {
+            __m128i over = _mm_cmpgt_epi32(lux[half], threshold);
+
+            if (_mm_movemask_epi8(over) != 0) {
+                __m128d low = compensate_sse2(_mm_cvtepi32_pd(lux[half]));
+                __m128d high = compensate_sse2(_mm_cvtepi32_pd(_mm_srli_si128(lux[half], 8)));
+                __m128i compensated = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+
+                lux[half] = _mm_or_si128(_mm_and_si128(over, compensated), _mm_andnot_si128(over, lux[half]));
+            }
+            _mm_storeu_si128((__m128i *)(lux_values + i + (half * 4)), lux[half]);
+        }
+    }
+    convert_scalar(light_bits + i, lux_values + i, count - i, lux_per_count);
+}
+
+// This function applies the compensation polynomial to four lux values in doubles.
+__attribute__((target("avx2"))) static inline __m256d compensate_avx2(__m256d x) {
+    __m256d term = _mm256_mul_pd(x, _mm256_set1_pd(compensation_a4));
+
+    term = _mm256_add_pd(_mm256_set1_pd(compensation_a3), term);
+    term = _mm256_mul_pd(x, term);
+    term = _mm256_add_pd(_mm256_set1_pd(compensation_a2), term);
+    term = _mm256_mul_pd(x, term);
+    term = _mm256_add_pd(_mm256_set1_pd(compensation_a1), term);
+    return _mm256_mul_pd(x, term);
+}
+
+// This function converts 16 counts per iteration with AVX2.
+__attribute__((target("avx2"))) static void convert_avx2(const uint16_t *light_bits, uint32_t *lux_values,
+                                                         size_t count, float lux_per_count) {
+    const __m256 factor = _mm256_set1_ps(lux_per_count);
+    const __m256i threshold = _mm256_set1_epi32(compensation_threshold);
+    size_t i = 0;
+
+    for (; (i + 16) <= count; i += 16) {
+        __m256i bits = _mm256_loadu_si256((const __m256i *)(light_bits + i));
+        __m256i lux[2];
+
+        lux[0] = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(bits));
+        lux[1] = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(bits, 1));
+        for (int half = 0; half < 2; ++half) {
+            lux[half] = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(lux[half]), factor));
+
+            __m256i over = _mm256_cmpgt_epi32(lux[half], threshold);
+
+            if (_mm256_movemask_epi8(over) != 0) {
+                __m256d low = compensate_avx2(_mm256_cvtepi32_pd(_mm256_castsi256_si128(lux[half])));
+                __m256d high = compensate_avx2(_mm256_cvtepi32_pd(_mm256_extracti128_si256(lux[half], 1)));
+                __m256i compensated = _mm256_set_m128i(_mm256_cvttpd_epi32(high), _mm256_cvttpd_epi32(low));
+
+                lux[half] = _mm256_blendv_epi8(lux[half], compensated, over);
+            }
+            _mm256_storeu_si256((__m256i *)(lux_values + i + (half * 8)), lux[half]);
+        }
+    }
+    convert_scalar(light_bits + i, lux_values + i, count - i, lux_per_count);
+}
+#endif
+
+#ifdef VEML6030_NEON_KERNEL
+// This function applies the compensation polynomial to two lux values in doubles.
+static inline float64x2_t compensate_neon(float64x2_t x) {
+    float64x2_t term = vmulq_f64(x, vdupq_n_f64(compensation_a4));
+
+    term = vaddq_f64(vdupq_n_f64(compensation_a3), term);
+    term = vmulq_f64(x, term);
+    term = vaddq_f64(vdupq_n_f64(compensation_a2), term);
+    term = vmulq_f64(x, term);
+    term = vaddq_f64(vdupq_n_f64(compensation_a1), term);
+    return vmulq_f64(x, term);
+}
+
+// This function converts 8 counts per iteration with AArch64 NEON.
+static void convert_neon(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                         float lux_per_count) {
+    const float32x4_t factor = vdupq_n_f32(lux_per_count);
+    const uint32x4_t threshold = vdupq_n_u32(compensation_threshold);
+    size_t i = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        uint16x8_t bits = vld1q_u16(light_bits + i);
+        uint32x4_t lux[2];
+
+        lux[0] = vmovl_u16(vget_low_u16(bits));
+        lux[1] = vmovl_u16(vget_high_u16(bits));
+        for (int half = 0; half < 2; ++half) {
+            lux[half] = vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(lux[half]), factor));
+
+            uint32x4_t over = vcgtq_u32(lux[half], threshold);
+
+            if (vmaxvq_u32(over) != 0) {
+                float64x2_t low = compensate_neon(vcvtq_f64_u64(vmovl_u32(vget_low_u32(lux[half]))));
+                float64x2_t high = compensate_neon(vcvtq_f64_u64(vmovl_u32(vget_high_u32(lux[half]))));
+                uint32x4_t compensated = vcombine_u32(vmovn_u64(vcvtq_u64_f64(low)), vmovn_u64(vcvtq_u64_f64(high)));
+
+                lux[half] = vbslq_u32(over, compensated, lux[half]);
+            }
+            vst1q_u32(lux_values + i + (half * 4), lux[half]);
+        }
+    }
+    convert_scalar(light_bits + i, lux_values + i, count - i, lux_per_count);
+}
+#endif
+
+struct kernel_choice {
+    convert_kernel kernel;
+    const char *name;
+};
+
+// This function picks the widest kernel the processor supports.
+static kernel_choice choose_kernel() {
+    kernel_choice choice;
+
+#if defined(VEML6030_X86_KERNELS)
+    if (__builtin_cpu_supports("avx2")) {
+        choice.kernel = convert_avx2;
+        choice.name = "avx2";
+    } else {
+        choice.kernel = convert_sse2;
+        choice.name = "sse2";
+    }
+#elif defined(VEML6030_NEON_KERNEL)
+    choice.kernel = convert_neon;
+    choice.name = "neon";
+#else
+    choice.kernel = convert_scalar;
+    choice.name = "scalar";
+#endif
+    return choice;
+}
+
+static const kernel_choice &selected_kernel() {
+    static const kernel_choice choice = choose_kernel();
+    return choice;
+}
+
+void veml6030_convert_counts(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                             uint16_t setting_reg) {
+    selected_kernel().kernel(light_bits, lux_values, count, veml6030_conversion_for(setting_reg).lux_per_count);
+}
+
+void veml6030_convert_counts_scalar(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                                    uint16_t setting_reg) {
+    convert_scalar(light_bits, lux_values, count, veml6030_conversion_for(setting_reg).lux_per_count);
+}
+
+const char *veml6030_convert_counts_kernel() {
+    return selected_kernel().name;
+}
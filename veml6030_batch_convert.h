@@ -0,0 +1,24 @@
+#ifndef _VEML6030_BATCH_CONVERT_H_
+#define _VEML6030_BATCH_CONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Converts arrays of raw light channel counts to lux without a sensor, for
+// reprocessing recorded data or converting bursts from many sensors. The counts
+// must all have been read with the gain and integration time fields of
+// setting_reg. The result for each count is the same as the driver's
+// calculate_lux() followed by veml6030_lux_compensation() above 1000 lux.
+//
+// The work is done by a vector kernel picked once at run time: AVX2 or SSE2 on
+// x86-64, NEON on AArch64, or a scalar loop elsewhere.
+void veml6030_convert_counts(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                             uint16_t setting_reg);
+
+// This function converts with the scalar loop only, as a reference.
+void veml6030_convert_counts_scalar(const uint16_t *light_bits, uint32_t *lux_values, size_t count,
+                                    uint16_t setting_reg);
+
+// This function returns the name of the kernel veml6030_convert_counts() uses.
+const char *veml6030_convert_counts_kernel();
+#endif
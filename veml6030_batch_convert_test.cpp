@@ -0,0 +1,94 @@
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_batch_convert.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_test.h"
+
+static const float gains[] = {2, 1, .25, .125};
+static const uint16_t integration_times[] = {800, 400, 200, 100, 50, 25};
+
+// For every setting the driver takes and every count, the selected kernel and the
+// scalar loop give exactly the driver's calculate_lux() followed by
+// veml6030_lux_compensation() above 1000 lux.
+static void test_matches_driver() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    std::vector<uint16_t> light_bits(0x10000);
+    std::vector<uint32_t> lux_values(0x10000);
+    std::vector<uint32_t> scalar_values(0x10000);
+
+    VEML6030_CHECK(veml6030_convert_counts_kernel() != NULL);
+    for (uint32_t i = 0; i <= 0xFFFF; ++i) {
+        light_bits[i] = i;
+    }
+    for (int t = 0; t < 6; ++t) {
+        for (int g = 0; g < 4; ++g) {
+            int mismatches = 0;
+
+            light.set_gain(gains[g]);
+            light.set_integration_time(integration_times[t]);
+            uint16_t setting_reg = light.read_register_checked(SETTING_REG).value;
+
+            veml6030_convert_counts(&light_bits[0], &lux_values[0], light_bits.size(), setting_reg);
+            veml6030_convert_counts_scalar(&light_bits[0], &scalar_values[0], light_bits.size(), setting_reg);
+            for (uint32_t i = 0; i <= 0xFFFF; ++i) {
+                uint32_t expected = light.calculate_lux(i);
+
+                if (expected > 1000) {
+                    expected = veml6030_lux_compensation(expected);
+                }
+                if ((lux_values[i] != expected) || (scalar_values[i] != expected)) {
+                    ++mismatches;
+                }
+            }
+            VEML6030_CHECK(mismatches == 0);
+        }
+    }
+}
+
+// Arrays of any length and alignment convert the same, including the tails the
+// vector kernels leave to the scalar loop, and nothing past the end is written.
+static void test_lengths_and_alignment() {
+    const uint16_t setting_reg = (2 << GAIN_POS) | (12 << INTEGRATION_TIME_POS);
+    uint16_t light_bits[80];
+    uint32_t lux_values[80];
+    uint32_t scalar_values[80];
+
+    for (int i = 0; i < 80; ++i) {
+        light_bits[i] = (uint16_t)(i * 821 + 500);
+    }
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t count = 0; count <= 40; ++count) {
+            memset(lux_values, 0xA5, sizeof(lux_values));
+            veml6030_convert_counts(light_bits + offset, lux_values + offset, count, setting_reg);
+            veml6030_convert_counts_scalar(light_bits + offset, scalar_values + offset, count, setting_reg);
+            VEML6030_CHECK(memcmp(lux_values + offset, scalar_values + offset, count * sizeof(uint32_t)) == 0);
+            VEML6030_CHECK(lux_values[offset + count] == 0xA5A5A5A5);
+        }
+    }
+}
+
+// A reserved integration time has no conversion, so every count is 0 lux.
+static void test_reserved_setting() {
+    uint16_t light_bits[19];
+    uint32_t lux_values[19];
+
+    for (int i = 0; i < 19; ++i) {
+        light_bits[i] = (uint16_t)(i * 3000);
+        lux_values[i] = 1;
+    }
+    veml6030_convert_counts(light_bits, lux_values, 19, 4 << INTEGRATION_TIME_POS);
+    for (int i = 0; i < 19; ++i) {
+        VEML6030_CHECK(lux_values[i] == 0);
+    }
+}
+
+int main() {
+    test_matches_driver();
+    test_lengths_and_alignment();
+    test_reserved_setting();
+    return veml6030_test_result();
+}
@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_clock.h"
+#include "veml6030_fake_transport.h"
+
+// Microbenchmarks of the driver's hot paths against the in-process simulated
+// VEML6030, so driver changes can be measured on machines without i2c
+// hardware. Each case reports the time per operation and the bus transactions
+// per operation. With --latency the simulated bus takes that long per
+// transaction, which shows how much of a call is bus time.
+
+static const int benchmark_address = 0x48;
+
+// Results are accumulated here so the compiler can't drop the work.
+static volatile uint32_t benchmark_sink;
+
+struct benchmark_case {
+    const char *name;
+    void (*operation)(SparkFun_Ambient_Light &sensor, unsigned long iteration);
+};
+
+static void bench_read_light(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    (void)iteration;
+    benchmark_sink = benchmark_sink + sensor.read_light();
+}
+
+static void bench_read_white_light(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    (void)iteration;
+    benchmark_sink = benchmark_sink + sensor.read_white_light();
+}
+
+static void bench_read_sample(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    veml6030_sample sample;
+
+    (void)iteration;
+    sensor.read_sample(sample);
+    benchmark_sink = benchmark_sink + sample.ambient_light_lux;
+}
+
+static void bench_calculate_lux(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    benchmark_sink = benchmark_sink + sensor.calculate_lux(iteration & 0xffff);
+}
+
+static void bench_lux_compensation(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    benchmark_sink = benchmark_sink + sensor.lux_compensation(1000 + (iteration & 0xffff));
+}
+
+static void bench_set_gain(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    sensor.set_gain((iteration & 1) ? .25 : .125);
+}
+
+static void bench_set_integration_time(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    sensor.set_integration_time((iteration & 1) ? 200 : 100);
+}
+
+static void bench_set_power_save_mode(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    sensor.set_power_save_mode((iteration & 1) ? 2 : 1);
+}
+
+static void bench_set_interrupt_high_threshold(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    sensor.set_interrupt_high_threshold((iteration & 1) ? 2000 : 1000);
+}
+
+// set_protect() is a single field read-modify-write, so it measures write_register() itself.
+static void bench_write_register(SparkFun_Ambient_Light &sensor, unsigned long iteration) {
+    sensor.set_protect((iteration & 1) ? 2 : 1);
+}
+
+static const benchmark_case benchmark_cases[] = {
+    {"read_light", bench_read_light},
+    {"read_white_light", bench_read_white_light},
+    {"read_sample", bench_read_sample},
+    {"calculate_lux", bench_calculate_lux},
+    {"lux_compensation", bench_lux_compensation},
+    {"set_gain", bench_set_gain},
+    {"set_integration_time", bench_set_integration_time},
+    {"set_power_save_mode", bench_set_power_save_mode},
+    {"set_interrupt_high_threshold", bench_set_interrupt_high_threshold},
+    {"write_register (set_protect)", bench_write_register},
+};
+
+static void usage(const char *program_name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -l, --latency <ns>       simulated bus time per transaction (default 0)\n"
+            "  -n, --iterations <count> operations per case (default 1000000, 10000 with latency)\n"
+            "  -t, --lux-table          convert with the lux lookup table\n"
+            "  -f, --filter <text>      only run cases whose name contains text\n",
+            program_name);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {{"latency", required_argument, NULL, 'l'},
+                                                 {"iterations", required_argument, NULL, 'n'},
+                                                 {"lux-table", no_argument, NULL, 't'},
+                                                 {"filter", required_argument, NULL, 'f'},
+                                                 {"help", no_argument, NULL, 'h'},
+                                                 {NULL, 0, NULL, 0}};
+    fake_veml6030_transport fake_transport(benchmark_address);
+    int64_t latency_ns = 0;
+    unsigned long iterations = 0;
+    bool lux_table = false;
+    const char *filter = NULL;
+    int option;
+
+    while ((option = getopt_long(argc, argv, "l:n:tf:h", long_options, NULL)) != -1) {
+        switch (option) {
+        case 'l':
+            latency_ns = strtoll(optarg, NULL, 0);
+            break;
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            lux_table = true;
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (iterations == 0) {
+        iterations = (latency_ns > 0) ? 10000 : 1000000;
+    }
+
+    SparkFun_Ambient_Light sensor(&fake_transport, benchmark_address);
+    if (!sensor.begin()) {
+        return 1;
+    }
+    if (lux_table) {
+        sensor.enable_lux_table();
+    }
+    fake_transport.set_register(benchmark_address, AMBIENT_LIGHT_DATA_REG, 12345);
+    fake_transport.set_register(benchmark_address, WHITE_LIGHT_DATA_REG, 23456);
+    fake_transport.set_transaction_latency_ns(latency_ns);
+
+    printf("%-30s %12s %14s\n", "operation", "ns/op", "transactions/op");
+    for (size_t i = 0; i < (sizeof(benchmark_cases) / sizeof(benchmark_cases[0])); ++i) {
+        const benchmark_case &current = benchmark_cases[i];
+        unsigned long warmup = (iterations < 1000) ? iterations : 1000;
+        int64_t start_ns;
+        int64_t elapsed_ns;
+        double transactions;
+
+        if ((filter != NULL) && (strstr(current.name, filter) == NULL)) {
+            continue;
+        }
+        for (unsigned long iteration = 0; iteration < warmup; ++iteration) {
+            current.operation(sensor, iteration);
+        }
+        fake_transport.reset_counts();
+        start_ns = veml6030_monotonic_ns();
+        for (unsigned long iteration = 0; iteration < iterations; ++iteration) {
+            current.operation(sensor, iteration);
+        }
+        elapsed_ns = veml6030_monotonic_ns() - start_ns;
+        transactions = (double)(fake_transport.read_count() + fake_transport.write_count()) / iterations;
+        printf("%-30s %12.1f %14.2f\n", current.name, (double)elapsed_ns / iterations, transactions);
+    }
+    return 0;
+}
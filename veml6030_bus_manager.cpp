@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <errno.h>
+
+#include "veml6030_bus_manager.h"
+#include "veml6030_retry.h"
+
+veml6030_bus_manager::veml6030_bus_manager() : retry_policy(veml6030_default_retry_policy) {
+}
+
+veml6030_bus_manager::~veml6030_bus_manager() {
+    for (size_t i = 0; i < sensors.size(); ++i) {
+        delete sensors[i];
+    }
+    for (size_t i = 0; i < buses.size(); ++i) {
+        if (buses[i].owns_transport) {
+            delete buses[i].transport;
+        }
+    }
+}
+
+// This function adds the sensor at slave_address on the i2c adapter
+// i2c_bus_name, opening the adapter the first time it is used.
+int veml6030_bus_manager::add_sensor(const char *i2c_bus_name, int slave_address) {
+    for (size_t i = 0; i < buses.size(); ++i) {
+        if (buses[i].owns_transport && (buses[i].name == i2c_bus_name)) {
+            return add_sensor_to_bus(i, slave_address);
+        }
+    }
+
+    linux_i2c_transport *i2c_bus = new linux_i2c_transport(i2c_bus_name);
+    if (!i2c_bus->is_open()) {
+        fprintf(stderr, "i2c bus %s didn't open.\n", i2c_bus_name);
+        delete i2c_bus;
+        return -1;
+    }
+    managed_bus new_bus;
+    new_bus.name = i2c_bus_name;
+    new_bus.transport = i2c_bus;
+    new_bus.owns_transport = true;
+    buses.push_back(new_bus);
+    return add_sensor_to_bus(buses.size() - 1, slave_address);
+}
+
+// This function adds the sensor at slave_address reached through a caller owned bus.
+int veml6030_bus_manager::add_sensor(veml6030_transport *bus, int slave_address) {
+    for (size_t i = 0; i < buses.size(); ++i) {
+        if (buses[i].transport == bus) {
+            return add_sensor_to_bus(i, slave_address);
+        }
+    }
+
+    managed_bus new_bus;
+    new_bus.transport = bus;
+    new_bus.owns_transport = false;
+    buses.push_back(new_bus);
+    return add_sensor_to_bus(buses.size() - 1, slave_address);
+}
+
+// This function adds a sensor on the bus with index bus_index. The batch for the
+// bus is sized here so poll() never allocates.
+int veml6030_bus_manager::add_sensor_to_bus(int bus_index, int slave_address) {
+    managed_bus &bus = buses[bus_index];
+    veml6030_register_read read;
+    int sensor_index = sensors.size();
+
+    sensors.push_back(new SparkFun_Ambient_Light(bus.transport, slave_address));
+    bus.sensors.push_back(sensor_index);
+    bus.recovery_due.push_back(false);
+
+    read.slave_address = slave_address;
+    read.reg_value = 0;
+    read.status = 0;
+    read.reg = AMBIENT_LIGHT_DATA_REG;
+    bus.reads.push_back(read);
+    read.reg = WHITE_LIGHT_DATA_REG;
+    bus.reads.push_back(read);
+    return sensor_index;
+}
+
+int veml6030_bus_manager::sensor_count() const {
+    return sensors.size();
+}
+
+SparkFun_Ambient_Light *veml6030_bus_manager::sensor(int index) {
+    if ((index < 0) || (index >= (int)sensors.size())) {
+        return NULL;
+    }
+    return sensors[index];
+}
+
+void veml6030_bus_manager::set_retry_policy(const veml6030_retry_policy &policy) {
+    retry_policy = policy;
+}
+
+const veml6030_retry_policy &veml6030_bus_manager::get_retry_policy() const {
+    return retry_policy;
+}
+
+// This function reads both light channels of every sensor, one batch per bus.
+// The whole batch is retried on a transient error, since a failed I2C_RDWR
+// ioctl fails every read it carried, but not on a NAK. If a device didn't
+// answer, the sensors are read one at a time instead, so one missing sensor
+// doesn't cost the others their samples, and a sensor that NAKs its own read
+// isn't retried. Each sensor is then told how its reads went. The sensors share
+// the bus, so the bus is recovered here, once, rather than by each of them.
+int veml6030_bus_manager::poll(veml6030_sample *samples, bool *sample_ok) {
+    int good_samples = 0;
+
+    for (size_t b = 0; b < buses.size(); ++b) {
+        managed_bus &bus = buses[b];
+        bool recover = false;
+        int batch_status;
+
+        batch_status = veml6030_retry_access(
+            retry_policy, bus.transport->get_stats(),
+            [&]() { return bus.transport->read_registers(&bus.reads[0], bus.reads.size()); },
+            veml6030_is_transient_bus_error);
+        if (((batch_status == -EREMOTEIO) || (batch_status == -ENXIO)) && (bus.sensors.size() > 1)) {
+            for (size_t i = 0; i < bus.sensors.size(); ++i) {
+                bus.transport->read_registers(&bus.reads[i * 2], 2);
+            }
+        }
+        for (size_t i = 0; i < bus.sensors.size(); ++i) {
+            int sensor_index = bus.sensors[i];
+            const veml6030_register_read &ambient_read = bus.reads[(i * 2)];
+            const veml6030_register_read &white_read = bus.reads[(i * 2) + 1];
+            veml6030_sample &sample = samples[sensor_index];
+            int status = (ambient_read.status < 0) ? ambient_read.status : white_read.status;
+
+            sample_ok[sensor_index] = false;
+            bus.recovery_due[i] = sensors[sensor_index]->report_shared_access(status);
+            recover = (recover || bus.recovery_due[i]);
+            if (status < 0) {
+                continue;
+            }
+            sample.ambient_light_bits = ambient_read.reg_value;
+            sample.white_light_bits = white_read.reg_value;
+            sample.interrupt_status = NO_INT;
+            if (sensors[sensor_index]->convert_sample(sample)) {
+                sample_ok[sensor_index] = true;
+                ++good_samples;
+            }
+        }
+        if (recover) {
+            recover_bus(bus);
+        }
+    }
+    return good_samples;
+}
+
+// This function reopens the bus for all its sensors, then writes back the
+// configuration of the ones whose reads kept failing.
+void veml6030_bus_manager::recover_bus(managed_bus &bus) {
+    int reopen_status = bus.transport->reopen();
+
+    if ((reopen_status < 0) && (reopen_status != -EOPNOTSUPP)) {
+        fprintf(stderr, "i2c bus %s didn't reopen.\n", bus.name.c_str());
+        return;
+    }
+    for (size_t i = 0; i < bus.sensors.size(); ++i) {
+        if (bus.recovery_due[i]) {
+            sensors[bus.sensors[i]]->restore_configuration();
+            bus.recovery_due[i] = false;
+        }
+    }
+}
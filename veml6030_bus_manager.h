@@ -0,0 +1,72 @@
+#ifndef _VEML6030_BUS_MANAGER_H_
+#define _VEML6030_BUS_MANAGER_H_
+
+#include <string>
+#include <vector>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_transport.h"
+
+// Owns one transport per i2c adapter and any number of sensors on each. Every
+// poll() gathers the light channel reads of all the sensors on a bus into one
+// read_registers() batch, so a tick costs one ioctl per bus (split only at the
+// kernel's message limit) instead of one or more per sensor.
+class veml6030_bus_manager {
+  public:
+    veml6030_bus_manager();
+    ~veml6030_bus_manager();
+
+    // This function adds the sensor at slave_address on the i2c adapter
+    // i2c_bus_name (e.g. "/dev/i2c-1"), opening the adapter the first time it is
+    // used. It returns the sensor's index, or -1 if the adapter didn't open.
+    int add_sensor(const char *i2c_bus_name, int slave_address);
+
+    // This function adds the sensor at slave_address reached through bus, which
+    // the caller owns and which must outlive the manager. Sensors added with the
+    // same bus pointer share its batches. It returns the sensor's index.
+    int add_sensor(veml6030_transport *bus, int slave_address);
+
+    int sensor_count() const;
+
+    // This function returns the sensor with the given index, for configuring it.
+    SparkFun_Ambient_Light *sensor(int index);
+
+    // This function reads both light channels of every sensor, one batch per bus.
+    // samples and sample_ok must have room for sensor_count() entries and are
+    // indexed like the sensors. It returns the number of sensors read successfully.
+    // A batch that fails with a transient bus error is retried under the retry
+    // policy. A batch failed by a device that didn't answer isn't retried but
+    // split into one batch per sensor, so the sensors still there return
+    // samples. Each sensor's result is reported to its driver, and once repeated
+    // failures make any of them due for recovery the bus is reopened once and
+    // those sensors' configurations are written back.
+    int poll(veml6030_sample *samples, bool *sample_ok);
+
+    // These functions set and return the retry policy for the batched reads.
+    void set_retry_policy(const veml6030_retry_policy &policy);
+    const veml6030_retry_policy &get_retry_policy() const;
+
+  private:
+    struct managed_bus {
+        std::string name;
+        veml6030_transport *transport;
+        bool owns_transport;
+        std::vector<int> sensors;
+        std::vector<veml6030_register_read> reads;
+        std::vector<bool> recovery_due; // Per sensor, set by poll()
+    };
+
+    std::vector<managed_bus> buses;
+    std::vector<SparkFun_Ambient_Light *> sensors;
+    veml6030_retry_policy retry_policy;
+
+    // This function adds a sensor on the bus with index bus_index.
+    int add_sensor_to_bus(int bus_index, int slave_address);
+
+    // This function reopens bus once and restores the configuration of each of
+    // its sensors that is due for recovery.
+    void recover_bus(managed_bus &bus);
+
+    veml6030_bus_manager(const veml6030_bus_manager &) = delete;
+    veml6030_bus_manager &operator=(const veml6030_bus_manager &) = delete;
+};
+#endif
@@ -0,0 +1,63 @@
+#include <errno.h>
+#include <stdint.h>
+
+#include "veml6030_bus_manager.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_test.h"
+
+// Every sensor on a bus is read in one transaction, with its own values.
+static void test_one_batch_per_bus() {
+    fake_veml6030_transport transport(0x48);
+    veml6030_bus_manager manager;
+    veml6030_sample samples[2];
+    bool sample_ok[2];
+
+    transport.add_device(0x10);
+    transport.set_register(0x48, AMBIENT_LIGHT_DATA_REG, 1000);
+    transport.set_register(0x10, AMBIENT_LIGHT_DATA_REG, 2000);
+    transport.set_register(0x10, WHITE_LIGHT_DATA_REG, 3000);
+    VEML6030_CHECK(manager.add_sensor(&transport, 0x48) == 0);
+    VEML6030_CHECK(manager.add_sensor(&transport, 0x10) == 1);
+    VEML6030_CHECK(manager.sensor_count() == 2);
+
+    /* Let the drivers load their configuration first. */
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 2);
+    transport.reset_counts();
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 2);
+    VEML6030_CHECK(transport.read_count() == 1);
+    VEML6030_CHECK(sample_ok[0] && sample_ok[1]);
+    VEML6030_CHECK(samples[0].ambient_light_bits == 1000);
+    VEML6030_CHECK((samples[1].ambient_light_bits == 2000) && (samples[1].white_light_bits == 3000));
+}
+
+// A sensor that stops answering fails the batch, but the others are still read.
+static void test_missing_sensor() {
+    fake_veml6030_transport transport(0x48);
+    veml6030_bus_manager manager;
+    veml6030_sample samples[3];
+    bool sample_ok[3];
+
+    transport.add_device(0x10);
+    transport.add_device(0x20);
+    transport.set_register(0x20, AMBIENT_LIGHT_DATA_REG, 500);
+    manager.add_sensor(&transport, 0x48);
+    manager.add_sensor(&transport, 0x10);
+    manager.add_sensor(&transport, 0x20);
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 3);
+
+    transport.remove_device(0x10);
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 2);
+    VEML6030_CHECK(sample_ok[0] && !sample_ok[1] && sample_ok[2]);
+    VEML6030_CHECK(samples[2].ambient_light_bits == 500);
+    VEML6030_CHECK(manager.sensor(1)->get_last_status() == -ENXIO);
+    VEML6030_CHECK(manager.sensor(0)->get_last_status() == 0);
+
+    transport.add_device(0x10);
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 3);
+}
+
+int main() {
+    test_one_batch_per_bus();
+    test_missing_sensor();
+    return veml6030_test_result();
+}
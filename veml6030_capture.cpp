@@ -0,0 +1,330 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "veml6030_capture.h"
+
+// This function returns the size in bytes of a block holding block_capacity
+// samples: the header and the four columns, rounded up to whole pages.
+uint64_t veml6030_capture_block_size(uint32_t block_capacity) {
+    uint64_t block_size = sizeof(veml6030_capture_block_header) +
+                          ((uint64_t)block_capacity * (sizeof(uint32_t) + sizeof(uint16_t) +
+                                                        sizeof(uint16_t) + sizeof(uint8_t)));
+
+    return (block_size + veml6030_capture_page_size - 1) & ~(veml6030_capture_page_size - 1);
+}
+
+// This function returns the columns of a block starting at block_start.
+static veml6030_capture_block_view block_columns(const uint8_t *block_start, uint32_t block_capacity) {
+    veml6030_capture_block_view view;
+    const uint8_t *column = block_start + sizeof(veml6030_capture_block_header);
+
+    view.header = (const veml6030_capture_block_header *)block_start;
+    view.timestamp_delta_us = (const uint32_t *)column;
+    column += block_capacity * sizeof(uint32_t);
+    view.ambient_light_bits = (const uint16_t *)column;
+    column += block_capacity * sizeof(uint16_t);
+    view.white_light_bits = (const uint16_t *)column;
+    column += block_capacity * sizeof(uint16_t);
+    view.config_epoch = column;
+    return view;
+}
+
+veml6030_capture_writer::veml6030_capture_writer()
+    : fd_capture_file(-1),
+      block_capacity(0),
+      block_size(0),
+      block_index(0),
+      last_timestamp_ns(0),
+      block_buffer(NULL),
+      block_header(NULL),
+      timestamp_delta_us(NULL),
+      ambient_light_bits(NULL),
+      white_light_bits(NULL),
+      config_epoch(NULL) {
+}
+
+veml6030_capture_writer::~veml6030_capture_writer() {
+    close();
+}
+
+// This function opens file_name for appending, creating it if needed.
+bool veml6030_capture_writer::open(const char *file_name, uint32_t block_capacity) {
+    veml6030_capture_file_header file_header;
+    struct stat file_status;
+
+    close();
+    if ((block_capacity == 0) || (block_capacity > (1 << 24))) {
+        return false;
+    }
+    fd_capture_file = ::open(file_name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_capture_file < 0) {
+        perror("open() of capture file in veml6030_capture_writer");
+        return false;
+    }
+    if (fstat(fd_capture_file, &file_status) < 0) {
+        perror("fstat() of capture file in veml6030_capture_writer");
+        close();
+        return false;
+    }
+
+    if (file_status.st_size == 0) {
+        memset(&file_header, 0, sizeof(file_header));
+        file_header.magic = veml6030_capture_file_magic;
+        file_header.version = veml6030_capture_version;
+        file_header.block_capacity = block_capacity;
+        file_header.block_size = veml6030_capture_block_size(block_capacity);
+        if (pwrite(fd_capture_file, &file_header, sizeof(file_header), 0) != sizeof(file_header)) {
+            perror("pwrite() of capture file header in veml6030_capture_writer");
+            close();
+            return false;
+        }
+        block_index = 0;
+    } else {
+        if ((pread(fd_capture_file, &file_header, sizeof(file_header), 0) != sizeof(file_header)) ||
+            (file_header.magic != veml6030_capture_file_magic) ||
+            (file_header.version != veml6030_capture_version) ||
+            (file_header.block_size != veml6030_capture_block_size(file_header.block_capacity))) {
+            fprintf(stderr, "%s isn't a compatible capture file.\n", file_name);
+            close();
+            return false;
+        }
+        /* Continue after the last (possibly partial) block. */
+        block_index = (file_status.st_size > (off_t)veml6030_capture_page_size)
+                          ? ((file_status.st_size - veml6030_capture_page_size + file_header.block_size - 1) /
+                             file_header.block_size)
+                          : 0;
+    }
+    this->block_capacity = file_header.block_capacity;
+    block_size = file_header.block_size;
+
+    block_buffer = (uint8_t *)malloc(block_size);
+    if (block_buffer == NULL) {
+        close();
+        return false;
+    }
+    block_header = (veml6030_capture_block_header *)block_buffer;
+    veml6030_capture_block_view view = block_columns(block_buffer, this->block_capacity);
+    timestamp_delta_us = (uint32_t *)view.timestamp_delta_us;
+    ambient_light_bits = (uint16_t *)view.ambient_light_bits;
+    white_light_bits = (uint16_t *)view.white_light_bits;
+    config_epoch = (uint8_t *)view.config_epoch;
+    start_block();
+    return true;
+}
+
+// This function flushes and closes the file.
+void veml6030_capture_writer::close() {
+    if (fd_capture_file >= 0) {
+        if (block_buffer != NULL) {
+            flush();
+        }
+        ::close(fd_capture_file);
+        fd_capture_file = -1;
+    }
+    free(block_buffer);
+    block_buffer = NULL;
+    block_header = NULL;
+}
+
+bool veml6030_capture_writer::is_open() const {
+    return (fd_capture_file >= 0);
+}
+
+// This function empties the block buffer for the next block. Unused column
+// entries stay zero so partial blocks are deterministic on disk.
+void veml6030_capture_writer::start_block() {
+    memset(block_buffer, 0, block_size);
+    block_header->magic = veml6030_capture_block_magic;
+}
+
+// This function writes the current block at its place in the file.
+bool veml6030_capture_writer::write_block() {
+    off_t block_offset = veml6030_capture_page_size + (block_index * block_size);
+
+    if (pwrite(fd_capture_file, block_buffer, block_size, block_offset) != (ssize_t)block_size) {
+        perror("pwrite() of capture block in veml6030_capture_writer");
+        return false;
+    }
+    return true;
+}
+
+// This function adds a sample. A new block is started when the current one is
+// full, when the time since the previous sample doesn't fit the delta column, or
+// when the block's configuration table is full.
+bool veml6030_capture_writer::append(const veml6030_timed_sample &timed_sample) {
+    uint32_t count;
+    uint32_t epoch;
+    int64_t delta_us = 0;
+    bool return_code = true;
+
+    if (fd_capture_file < 0) {
+        return false;
+    }
+    count = block_header->sample_count;
+    if (count > 0) {
+        delta_us = (timed_sample.timestamp_ns - last_timestamp_ns) / 1000;
+    }
+    for (epoch = 0; epoch < block_header->config_count; ++epoch) {
+        if ((block_header->setting_reg[epoch] == timed_sample.sample.setting_reg) &&
+            (block_header->power_save_reg[epoch] == timed_sample.sample.power_save_reg)) {
+            break;
+        }
+    }
+    if ((count == block_capacity) || (delta_us < 0) || (delta_us > UINT32_MAX) ||
+        (epoch == veml6030_capture_max_configs)) {
+        return_code = write_block();
+        ++block_index;
+        start_block();
+        count = 0;
+        epoch = 0;
+    }
+
+    if (count == 0) {
+        block_header->first_timestamp_ns = timed_sample.timestamp_ns;
+        block_header->epoch_ms_offset = veml6030_monotonic_to_epoch_ms_offset();
+        last_timestamp_ns = timed_sample.timestamp_ns;
+        delta_us = 0;
+    }
+    if (epoch == block_header->config_count) {
+        block_header->setting_reg[epoch] = timed_sample.sample.setting_reg;
+        block_header->power_save_reg[epoch] = timed_sample.sample.power_save_reg;
+        ++block_header->config_count;
+    }
+    /* Track the time the reader will reconstruct, so rounding never accumulates. */
+    last_timestamp_ns += delta_us * 1000;
+    timestamp_delta_us[count] = delta_us;
+    ambient_light_bits[count] = timed_sample.sample.ambient_light_bits;
+    white_light_bits[count] = timed_sample.sample.white_light_bits;
+    config_epoch[count] = epoch;
+    block_header->sample_count = count + 1;
+    return return_code;
+}
+
+// This function writes the partly filled current block so readers can see it.
+bool veml6030_capture_writer::flush() {
+    if ((fd_capture_file < 0) || (block_header->sample_count == 0)) {
+        return true;
+    }
+    return write_block();
+}
+
+veml6030_capture_reader::veml6030_capture_reader()
+    : mapped_file(NULL),
+      mapped_size(0),
+      block_capacity(0),
+      block_size(0),
+      blocks(0),
+      cursor_block(0),
+      cursor_index(0),
+      cursor_timestamp_ns(0) {
+}
+
+veml6030_capture_reader::~veml6030_capture_reader() {
+    close();
+}
+
+// This function maps file_name. It returns false if it isn't a capture file.
+bool veml6030_capture_reader::open(const char *file_name) {
+    const veml6030_capture_file_header *file_header;
+    struct stat file_status;
+    int fd_capture_file;
+
+    close();
+    fd_capture_file = ::open(file_name, O_RDONLY | O_CLOEXEC);
+    if (fd_capture_file < 0) {
+        perror("open() of capture file in veml6030_capture_reader");
+        return false;
+    }
+    if ((fstat(fd_capture_file, &file_status) < 0) ||
+        (file_status.st_size < (off_t)sizeof(veml6030_capture_file_header))) {
+        ::close(fd_capture_file);
+        return false;
+    }
+    mapped_size = file_status.st_size;
+    void *mapping = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, fd_capture_file, 0);
+    ::close(fd_capture_file);
+    if (mapping == MAP_FAILED) {
+        perror("mmap() of capture file in veml6030_capture_reader");
+        mapped_size = 0;
+        return false;
+    }
+    mapped_file = (const uint8_t *)mapping;
+
+    file_header = (const veml6030_capture_file_header *)mapped_file;
+    if ((file_header->magic != veml6030_capture_file_magic) ||
+        (file_header->version != veml6030_capture_version) || (file_header->block_capacity == 0) ||
+        (file_header->block_size != veml6030_capture_block_size(file_header->block_capacity))) {
+        fprintf(stderr, "%s isn't a compatible capture file.\n", file_name);
+        close();
+        return false;
+    }
+    block_capacity = file_header->block_capacity;
+    block_size = file_header->block_size;
+    blocks = (mapped_size > veml6030_capture_page_size)
+                 ? ((mapped_size - veml6030_capture_page_size) / block_size)
+                 : 0;
+    rewind();
+    return true;
+}
+
+void veml6030_capture_reader::close() {
+    if (mapped_file != NULL) {
+        munmap((void *)mapped_file, mapped_size);
+    }
+    mapped_file = NULL;
+    mapped_size = 0;
+    blocks = 0;
+}
+
+size_t veml6030_capture_reader::block_count() const {
+    return blocks;
+}
+
+// This function returns the columns of block block_index.
+veml6030_capture_block_view veml6030_capture_reader::block(size_t block_index) const {
+    return block_columns(mapped_file + veml6030_capture_page_size + (block_index * block_size), block_capacity);
+}
+
+// This function returns the next sample in the file, skipping blocks that were
+// never completely written.
+bool veml6030_capture_reader::next(veml6030_capture_record &record) {
+    while (cursor_block < blocks) {
+        veml6030_capture_block_view view = block(cursor_block);
+
+        if ((view.header->magic != veml6030_capture_block_magic) || (cursor_index >= view.header->sample_count) ||
+            (view.header->sample_count > block_capacity)) {
+            ++cursor_block;
+            cursor_index = 0;
+            continue;
+        }
+        if (cursor_index == 0) {
+            cursor_timestamp_ns = view.header->first_timestamp_ns;
+        } else {
+            cursor_timestamp_ns += (int64_t)view.timestamp_delta_us[cursor_index] * 1000;
+        }
+        uint8_t epoch = view.config_epoch[cursor_index];
+
+        record.timestamp_ns = cursor_timestamp_ns;
+        record.epoch_ms_offset = view.header->epoch_ms_offset;
+        record.ambient_light_bits = view.ambient_light_bits[cursor_index];
+        record.white_light_bits = view.white_light_bits[cursor_index];
+        record.setting_reg = view.header->setting_reg[epoch];
+        record.power_save_reg = view.header->power_save_reg[epoch];
+        ++cursor_index;
+        return true;
+    }
+    return false;
+}
+
+void veml6030_capture_reader::rewind() {
+    cursor_block = 0;
+    cursor_index = 0;
+    cursor_timestamp_ns = 0;
+}
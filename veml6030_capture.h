@@ -0,0 +1,151 @@
+#ifndef _VEML6030_CAPTURE_H_
+#define _VEML6030_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "veml6030_acquisition.h"
+
+// Compact append only capture files of raw sensor samples.
+//
+// A capture file is a file header page followed by fixed size blocks. Each block is a
+// header and then one column per field, each sized for the block capacity:
+//
+//   uint32_t timestamp_delta_us[] - time since the previous sample (0 for the first)
+//   uint16_t ambient_light_bits[] - raw REG0x04 counts
+//   uint16_t white_light_bits[]   - raw REG0x05 counts
+//   uint8_t  config_epoch[]       - index into the block's configuration table
+//
+// which is 9 bytes per sample. Blocks are a multiple of the page size, so a file
+// can be memory mapped and its columns used in place without parsing. Values are
+// in the byte order of the machine that wrote the file.
+static const uint64_t veml6030_capture_file_magic = 0x5041433033303656ULL; /* "V6030CAP" */
+static const uint32_t veml6030_capture_block_magic = 0x4B4C4256;           /* "VBLK" */
+static const uint32_t veml6030_capture_version = 1;
+static const uint32_t veml6030_capture_max_configs = 256;
+static const uint64_t veml6030_capture_page_size = 4096; // File header page and block size unit
+
+struct veml6030_capture_file_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t block_capacity; // Samples per block
+    uint64_t block_size;     // Bytes per block, including its header
+    uint8_t reserved[40];
+};
+
+struct veml6030_capture_block_header {
+    uint32_t magic;
+    uint32_t sample_count;
+    int64_t first_timestamp_ns;  // CLOCK_MONOTONIC time of the first sample
+    int64_t epoch_ms_offset;     // Add to a timestamp in ms to get ms since the epoch
+    uint32_t config_count;
+    uint32_t reserved;
+    uint16_t setting_reg[veml6030_capture_max_configs];    // REG0x00 per config epoch
+    uint16_t power_save_reg[veml6030_capture_max_configs]; // REG0x03 per config epoch
+};
+
+// The columns of one block, pointing into a mapped file or a writer's buffer.
+struct veml6030_capture_block_view {
+    const veml6030_capture_block_header *header;
+    const uint32_t *timestamp_delta_us;
+    const uint16_t *ambient_light_bits;
+    const uint16_t *white_light_bits;
+    const uint8_t *config_epoch;
+};
+
+// One sample read back from a capture file.
+struct veml6030_capture_record {
+    int64_t timestamp_ns; // CLOCK_MONOTONIC time the sample was read
+    int64_t epoch_ms_offset;
+    uint16_t ambient_light_bits;
+    uint16_t white_light_bits;
+    uint16_t setting_reg;
+    uint16_t power_save_reg;
+};
+
+// Appends samples to a capture file. Samples are collected in a block buffer in
+// memory and each block is written with a single write when it fills (or when
+// flush() is called), so the per sample cost is a few stores.
+class veml6030_capture_writer {
+  public:
+    static const uint32_t default_block_capacity = 4096;
+
+    veml6030_capture_writer();
+    ~veml6030_capture_writer();
+
+    // This function opens file_name for appending, creating it if needed. An
+    // existing capture file is continued with a new block. It returns false if
+    // the file couldn't be opened or isn't a compatible capture file.
+    bool open(const char *file_name, uint32_t block_capacity = default_block_capacity);
+
+    // This function flushes and closes the file.
+    void close();
+
+    bool is_open() const;
+
+    // This function adds a sample. It returns false if a block write failed.
+    bool append(const veml6030_timed_sample &timed_sample);
+
+    // This function writes the partly filled current block so readers can see its
+    // samples. Later samples go into the same block, which is rewritten in place.
+    bool flush();
+
+  private:
+    int fd_capture_file;
+    uint32_t block_capacity;
+    uint64_t block_size;
+    uint64_t block_index;
+    int64_t last_timestamp_ns;
+    uint8_t *block_buffer;
+    veml6030_capture_block_header *block_header;
+    uint32_t *timestamp_delta_us;
+    uint16_t *ambient_light_bits;
+    uint16_t *white_light_bits;
+    uint8_t *config_epoch;
+
+    // This function writes the current block at its place in the file.
+    bool write_block();
+
+    // This function empties the block buffer for the next block.
+    void start_block();
+
+    veml6030_capture_writer(const veml6030_capture_writer &) = delete;
+    veml6030_capture_writer &operator=(const veml6030_capture_writer &) = delete;
+};
+
+// Reads a capture file through a read only memory mapping.
+class veml6030_capture_reader {
+  public:
+    veml6030_capture_reader();
+    ~veml6030_capture_reader();
+
+    // This function maps file_name. It returns false if it isn't a capture file.
+    bool open(const char *file_name);
+    void close();
+
+    size_t block_count() const;
+
+    // This function returns the columns of block block_index.
+    veml6030_capture_block_view block(size_t block_index) const;
+
+    // These functions walk the samples in order: next() returns false at the end.
+    bool next(veml6030_capture_record &record);
+    void rewind();
+
+  private:
+    const uint8_t *mapped_file;
+    size_t mapped_size;
+    uint32_t block_capacity;
+    uint64_t block_size;
+    size_t blocks;
+
+    size_t cursor_block;
+    uint32_t cursor_index;
+    int64_t cursor_timestamp_ns;
+
+    veml6030_capture_reader(const veml6030_capture_reader &) = delete;
+    veml6030_capture_reader &operator=(const veml6030_capture_reader &) = delete;
+};
+
+// This function returns the size in bytes of a block holding block_capacity samples.
+uint64_t veml6030_capture_block_size(uint32_t block_capacity);
+#endif
@@ -0,0 +1,140 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "veml6030_capture.h"
+#include "veml6030_replay.h"
+#include "veml6030_test.h"
+
+static const uint32_t block_capacity = 64;
+
+// This function appends count samples one period_ns apart to the capture file,
+// starting at first_ns, with ambient light counts from first_bits up.
+static bool write_session(const char *file_name, int64_t first_ns, int64_t period_ns, int count,
+                          uint16_t first_bits) {
+    veml6030_capture_writer writer;
+    veml6030_timed_sample timed_sample = {};
+
+    if (!writer.open(file_name, block_capacity)) {
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        timed_sample.timestamp_ns = first_ns + (i * period_ns);
+        timed_sample.sample.ambient_light_bits = first_bits + i;
+        timed_sample.sample.white_light_bits = 2 * i;
+        /* Change the gain halfway through, so the config table is exercised. */
+        timed_sample.sample.setting_reg = (i < (count / 2)) ? 0x0000 : 0x1000;
+        if (!writer.append(timed_sample)) {
+            return false;
+        }
+    }
+    writer.close();
+    return true;
+}
+
+// This function sets the epoch offset of blocks first_block onwards, as if they
+// had been written in a later boot with a different CLOCK_MONOTONIC.
+static bool set_epoch_ms_offset(const char *file_name, size_t first_block, int64_t epoch_ms_offset) {
+    veml6030_capture_block_header block_header;
+    int fd = open(file_name, O_RDWR);
+    uint64_t block_size = veml6030_capture_block_size(block_capacity);
+    bool written = true;
+
+    if (fd < 0) {
+        return false;
+    }
+    for (size_t b = first_block;; ++b) {
+        off_t block_offset = veml6030_capture_page_size + (b * block_size);
+
+        if (pread(fd, &block_header, sizeof(block_header), block_offset) != sizeof(block_header)) {
+            break;
+        }
+        block_header.epoch_ms_offset = epoch_ms_offset;
+        if (pwrite(fd, &block_header, sizeof(block_header), block_offset) != sizeof(block_header)) {
+            written = false;
+        }
+    }
+    close(fd);
+    return written;
+}
+
+// Samples read back match what was written, in order, across blocks.
+static void test_write_read(const char *file_name) {
+    veml6030_capture_reader reader;
+    veml6030_capture_record record;
+    int count = 0;
+    bool matched = true;
+
+    VEML6030_CHECK(write_session(file_name, 5000000000LL, 100000000LL, 200, 0));
+    VEML6030_CHECK(reader.open(file_name));
+    VEML6030_CHECK(reader.block_count() == 4);
+    while (reader.next(record)) {
+        if ((record.timestamp_ns != (5000000000LL + (count * 100000000LL))) ||
+            (record.ambient_light_bits != count) || (record.white_light_bits != (2 * count)) ||
+            (record.setting_reg != ((count < 100) ? 0x0000 : 0x1000))) {
+            matched = false;
+        }
+        ++count;
+    }
+    VEML6030_CHECK(count == 200);
+    VEML6030_CHECK(matched);
+}
+
+// A session appended after a reboot, with an earlier CLOCK_MONOTONIC, replays
+// after the first one with the recorded gap between them.
+static void test_multi_session_replay(const char *file_name) {
+    veml6030_capture_reader reader;
+    veml6030_capture_record record;
+    veml6030_replay replay;
+    veml6030_timed_sample samples[512];
+    int64_t first_offset_ms;
+    size_t count = 0;
+    bool in_order = true;
+
+    /* The first session runs from 5s to 24.9s on its clock, the second from 1s to 10.9s. */
+    VEML6030_CHECK(write_session(file_name, 1000000000LL, 100000000LL, 100, 100));
+    VEML6030_CHECK(reader.open(file_name));
+    VEML6030_CHECK(reader.next(record));
+    first_offset_ms = record.epoch_ms_offset;
+    reader.close();
+    /* Start the second session 60s after the first one ended in wall time. */
+    VEML6030_CHECK(set_epoch_ms_offset(file_name, 4, first_offset_ms + 24900 + 60000 - 1000));
+
+    VEML6030_CHECK(replay.open(file_name, 0));
+    replay.start();
+    for (int spins = 0; (count < 300) && (spins < 5000); ++spins) {
+        count += replay.drain(samples + count, 300 - count);
+        if (replay.finished() && (count >= replay.replayed_samples())) {
+            break;
+        }
+        usleep(1000);
+    }
+    replay.stop();
+    VEML6030_CHECK(count == 300);
+    for (size_t i = 1; i < count; ++i) {
+        if (samples[i].timestamp_ns < samples[i - 1].timestamp_ns) {
+            in_order = false;
+        }
+    }
+    VEML6030_CHECK(in_order);
+    VEML6030_CHECK(samples[200].sample.ambient_light_bits == 100);
+    VEML6030_CHECK((samples[200].timestamp_ns - samples[199].timestamp_ns) == 60000000000LL);
+    VEML6030_CHECK(((samples[0].timestamp_ns / 1000000) + replay.get_epoch_ms_offset()) ==
+                   ((5000000000LL / 1000000) + first_offset_ms));
+}
+
+int main() {
+    char file_name[] = "/tmp/veml6030_capture_test_XXXXXX";
+    int fd = mkstemp(file_name);
+
+    if (fd < 0) {
+        perror("mkstemp() in veml6030_capture_test");
+        return 1;
+    }
+    close(fd);
+    test_write_read(file_name);
+    test_multi_session_replay(file_name);
+    unlink(file_name);
+    return veml6030_test_result();
+}
@@ -0,0 +1,56 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "veml6030_chart_history.h"
+
+veml6030_chart_history::veml6030_chart_history(size_t capacity)
+    : points(capacity > 0 ? capacity : 1),
+      first(0),
+      count(0) {
+}
+
+// This function adds a point, overwriting the oldest one if the history is full.
+void veml6030_chart_history::append(int64_t time_ms, double value) {
+    size_t slot = first + count;
+
+    if (slot >= points.size()) {
+        slot -= points.size();
+    }
+    points[slot].time_ms = time_ms;
+    points[slot].value = value;
+    if (count < points.size()) {
+        ++count;
+    } else if (++first == points.size()) {
+        first = 0;
+    }
+}
+
+void veml6030_chart_history::clear() {
+    first = 0;
+    count = 0;
+}
+
+size_t veml6030_chart_history::size() const {
+    return count;
+}
+
+size_t veml6030_chart_history::capacity() const {
+    return points.size();
+}
+
+const veml6030_chart_point &veml6030_chart_history::oldest() const {
+    return points[first];
+}
+
+const veml6030_chart_point &veml6030_chart_history::newest() const {
+    return at(count - 1);
+}
+
+const veml6030_chart_point &veml6030_chart_history::at(size_t i) const {
+    size_t slot = first + i;
+
+    if (slot >= points.size()) {
+        slot -= points.size();
+    }
+    return points[slot];
+}
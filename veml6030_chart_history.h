@@ -0,0 +1,43 @@
+#ifndef _VEML6030_CHART_HISTORY_H_
+#define _VEML6030_CHART_HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// One plotted reading: a time in ms since the epoch and a value.
+struct veml6030_chart_point {
+    int64_t time_ms;
+    double value;
+};
+
+// Fixed capacity history of chart points. Once full, each new point replaces the
+// oldest one, so memory use doesn't grow with uptime.
+//
+// There is no Qt in here, so the history can be used and checked without a GUI.
+class veml6030_chart_history {
+  public:
+    static const size_t default_capacity = 65536;
+
+    veml6030_chart_history(size_t capacity = default_capacity);
+
+    // This function adds a point. Points must be added in time order.
+    void append(int64_t time_ms, double value);
+
+    void clear();
+    size_t size() const;
+    size_t capacity() const;
+
+    // These functions return the oldest and newest points. The history must not be empty.
+    const veml6030_chart_point &oldest() const;
+    const veml6030_chart_point &newest() const;
+
+    // This function returns point i, counting from the oldest.
+    const veml6030_chart_point &at(size_t i) const;
+
+  private:
+    std::vector<veml6030_chart_point> points;
+    size_t first;
+    size_t count;
+};
+#endif
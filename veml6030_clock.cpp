@@ -0,0 +1,23 @@
+#include <stdint.h>
+#include <time.h>
+
+#include "veml6030_clock.h"
+
+// This function returns the CLOCK_MONOTONIC time in nanoseconds.
+int64_t veml6030_monotonic_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+// This function returns the offset to add to a CLOCK_MONOTONIC time in
+// nanoseconds to get milliseconds since the epoch.
+int64_t veml6030_monotonic_to_epoch_ms_offset() {
+    struct timespec now;
+    int64_t realtime_ms;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    realtime_ms = ((int64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+    return realtime_ms - (veml6030_monotonic_ns() / 1000000);
+}
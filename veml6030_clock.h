@@ -0,0 +1,12 @@
+#ifndef _VEML6030_CLOCK_H_
+#define _VEML6030_CLOCK_H_
+
+#include <stdint.h>
+
+// This function returns the CLOCK_MONOTONIC time in nanoseconds.
+int64_t veml6030_monotonic_ns();
+
+// This function returns the offset to add to a CLOCK_MONOTONIC time in
+// nanoseconds to get milliseconds since the epoch, for display.
+int64_t veml6030_monotonic_to_epoch_ms_offset();
+#endif
@@ -0,0 +1,373 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_bus_manager.h"
+#include "veml6030_clock.h"
+#include "veml6030_collector.h"
+#include "veml6030_shm.h"
+
+// Headless sampler for one or more VEML6030s on one i2c adapter. It has no Qt
+// dependency, so it starts in milliseconds on machines without a display. Every
+// tick reads all the sensors in one batch and writes their samples with a single
+// write() to stdout or a UNIX domain stream socket, and/or publishes them in a
+// shared memory segment for local readers (see veml6030_shm.h).
+
+struct collector_options {
+    std::string bus_name;
+    std::vector<int> addresses;
+    unsigned int period_ms;
+    float gain;
+    uint16_t integration_time;
+    bool binary_output;
+    bool stream_output;
+    bool print_stats;
+    std::string shm_name;
+    std::string socket_path;
+    unsigned long sample_limit;
+};
+
+static void usage(const char *program_name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -b, --bus <device>         i2c adapter (default /dev/i2c-1)\n"
+            "  -a, --address <addr>       sensor address, may be repeated (default 0x48)\n"
+            "  -p, --period <ms>          sample period, 0 for the sensor refresh period (default 0)\n"
+            "  -g, --gain <gain>          0.125, 0.25, 1 or 2 (default 0.125)\n"
+            "  -i, --integration <ms>     25, 50, 100, 200, 400 or 800 (default 100)\n"
+            "  -f, --format <line|binary|none> output format (default line)\n"
+            "  -s, --socket <path>        write to the UNIX domain socket at path instead of stdout\n"
+            "  -m, --shm <name>           also publish to the shared memory segment name (e.g. /veml6030)\n"
+            "  -n, --count <samples>      stop after this many ticks (default run until signalled)\n"
+            "  -S, --stats                print i2c statistics to stderr on exit\n",
+            program_name);
+}
+
+// This function parses the command line. It returns false if it was invalid.
+static bool parse_options(int argc, char *argv[], collector_options &options) {
+    static const struct option long_options[] = {
+        {"bus", required_argument, NULL, 'b'},    {"address", required_argument, NULL, 'a'},
+        {"period", required_argument, NULL, 'p'}, {"gain", required_argument, NULL, 'g'},
+        {"integration", required_argument, NULL, 'i'}, {"format", required_argument, NULL, 'f'},
+        {"socket", required_argument, NULL, 's'}, {"count", required_argument, NULL, 'n'},
+        {"shm", required_argument, NULL, 'm'},    {"stats", no_argument, NULL, 'S'},
+        {"help", no_argument, NULL, 'h'},         {NULL, 0, NULL, 0}};
+    int option;
+    char *end;
+
+    options.bus_name = "/dev/i2c-1";
+    options.period_ms = 0;
+    options.gain = .125;
+    options.integration_time = 100;
+    options.binary_output = false;
+    options.stream_output = true;
+    options.print_stats = false;
+    options.sample_limit = 0;
+
+    while ((option = getopt_long(argc, argv, "b:a:p:g:i:f:s:n:m:Sh", long_options, NULL)) != -1) {
+        switch (option) {
+        case 'b':
+            options.bus_name = optarg;
+            break;
+        case 'a': {
+            long address = strtol(optarg, &end, 0);
+
+            if ((*end != '\0') || (address < 0x03) || (address > 0x77)) {
+                fprintf(stderr, "Invalid i2c address %s.\n", optarg);
+                return false;
+            }
+            options.addresses.push_back(address);
+            break;
+        }
+        case 'p':
+            options.period_ms = strtoul(optarg, &end, 0);
+            if (*end != '\0') {
+                fprintf(stderr, "Invalid period %s.\n", optarg);
+                return false;
+            }
+            break;
+        case 'g':
+            options.gain = strtof(optarg, &end);
+            if ((*end != '\0') || ((options.gain != .125f) && (options.gain != .25f) && (options.gain != 1.0f) &&
+                                   (options.gain != 2.0f))) {
+                fprintf(stderr, "Invalid gain %s.\n", optarg);
+                return false;
+            }
+            break;
+        case 'i': {
+            unsigned long integration_time = strtoul(optarg, &end, 0);
+
+            if ((*end != '\0') || ((integration_time != 25) && (integration_time != 50) &&
+                                   (integration_time != 100) && (integration_time != 200) &&
+                                   (integration_time != 400) && (integration_time != 800))) {
+                fprintf(stderr, "Invalid integration time %s.\n", optarg);
+                return false;
+            }
+            options.integration_time = integration_time;
+            break;
+        }
+        case 'f':
+            if (strcmp(optarg, "binary") == 0) {
+                options.binary_output = true;
+            } else if (strcmp(optarg, "line") == 0) {
+                options.binary_output = false;
+            } else if (strcmp(optarg, "none") == 0) {
+                options.stream_output = false;
+            } else {
+                fprintf(stderr, "Invalid format %s.\n", optarg);
+                return false;
+            }
+            break;
+        case 's':
+            options.socket_path = optarg;
+            break;
+        case 'm':
+            options.shm_name = optarg;
+            break;
+        case 'S':
+            options.print_stats = true;
+            break;
+        case 'n':
+            options.sample_limit = strtoul(optarg, &end, 0);
+            if (*end != '\0') {
+                fprintf(stderr, "Invalid count %s.\n", optarg);
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+    if (optind != argc) {
+        return false;
+    }
+    if (options.addresses.empty()) {
+        options.addresses.push_back(0x48);
+    }
+    if (!options.shm_name.empty() && (options.addresses.size() > veml6030_shm_max_sensors)) {
+        fprintf(stderr, "At most %u sensors can be published to shared memory.\n", veml6030_shm_max_sensors);
+        return false;
+    }
+    return true;
+}
+
+// This function connects to the UNIX domain stream socket at socket_path. It
+// returns the socket, or -1 on failure.
+static int connect_socket(const std::string &socket_path) {
+    struct sockaddr_un address;
+    int fd_socket;
+
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long.\n", socket_path.c_str());
+        return -1;
+    }
+    fd_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_socket < 0) {
+        perror("socket() in veml6030_collector");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size());
+    if (connect(fd_socket, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("connect() in veml6030_collector");
+        close(fd_socket);
+        return -1;
+    }
+    return fd_socket;
+}
+
+// This function writes all of buffer to fd_output. It returns false if the
+// reader went away or the write failed.
+static bool write_all(int fd_output, const char *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd_output, buffer, length);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EPIPE) {
+                perror("write() in veml6030_collector");
+            }
+            return false;
+        }
+        buffer += written;
+        length -= written;
+    }
+    return true;
+}
+
+// This function fills in the output record for one sample.
+static void make_record(const veml6030_sample &sample, int address, int64_t timestamp_ns,
+                        veml6030_collector_record &record) {
+    record.timestamp_ns = timestamp_ns;
+    record.address = address;
+    record.reserved = 0;
+    record.setting_reg = sample.setting_reg;
+    record.ambient_light_bits = sample.ambient_light_bits;
+    record.white_light_bits = sample.white_light_bits;
+    record.ambient_light_lux = sample.ambient_light_lux;
+    record.white_light_lux = sample.white_light_lux;
+}
+
+// This function appends one record to output in the selected format.
+static void format_record(const veml6030_collector_record &record, bool binary_output, std::string &output) {
+    if (binary_output) {
+        output.append((const char *)&record, sizeof(record));
+    } else {
+        char line[96];
+        int length = snprintf(line, sizeof(line), "%lld 0x%02x %u %u %u %u 0x%04x\n", (long long)record.timestamp_ns,
+                              record.address, record.ambient_light_lux, record.white_light_lux,
+                              record.ambient_light_bits, record.white_light_bits, record.setting_reg);
+
+        output.append(line, length);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    collector_options options;
+    veml6030_bus_manager bus_manager;
+    veml6030_shm_publisher shm_publisher;
+    std::vector<veml6030_sample> samples;
+    std::string output;
+    struct itimerspec timer_setting;
+    struct pollfd wait_fds[2];
+    sigset_t stop_signals;
+    unsigned long ticks = 0;
+    uint32_t refresh_period_ms = 0;
+    int fd_output = STDOUT_FILENO;
+    int fd_timer;
+    int fd_signal;
+    int return_code = 0;
+    bool *sample_ok;
+
+    if (!parse_options(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    for (size_t i = 0; i < options.addresses.size(); ++i) {
+        int index = bus_manager.add_sensor(options.bus_name.c_str(), options.addresses[i]);
+        SparkFun_Ambient_Light *sensor;
+
+        if (index < 0) {
+            return 1;
+        }
+        sensor = bus_manager.sensor(index);
+        if (!sensor->begin()) {
+            return 1;
+        }
+        sensor->set_gain(options.gain);
+        sensor->set_integration_time(options.integration_time);
+        if (sensor->read_refresh_period_ms() > refresh_period_ms) {
+            refresh_period_ms = sensor->read_refresh_period_ms();
+        }
+    }
+    /* By default read each sensor once per conversion of the slowest one. */
+    if (options.period_ms == 0) {
+        options.period_ms = (refresh_period_ms > 0) ? refresh_period_ms : options.integration_time;
+    }
+
+    if (!options.shm_name.empty() && !shm_publisher.open(options.shm_name.c_str(), bus_manager.sensor_count())) {
+        return 1;
+    }
+    if (options.stream_output && !options.socket_path.empty()) {
+        fd_output = connect_socket(options.socket_path);
+        if (fd_output < 0) {
+            return 1;
+        }
+    }
+
+    /* SIGINT and SIGTERM are taken through a signalfd so the loop can finish its tick and exit cleanly. */
+    signal(SIGPIPE, SIG_IGN);
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stop_signals, NULL);
+    fd_signal = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    fd_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if ((fd_signal < 0) || (fd_timer < 0)) {
+        perror("signalfd()/timerfd_create() in veml6030_collector");
+        return 1;
+    }
+    timer_setting.it_interval.tv_sec = options.period_ms / 1000;
+    timer_setting.it_interval.tv_nsec = (options.period_ms % 1000) * 1000000;
+    timer_setting.it_value = timer_setting.it_interval;
+    timerfd_settime(fd_timer, 0, &timer_setting, NULL);
+
+    samples.resize(bus_manager.sensor_count());
+    sample_ok = new bool[bus_manager.sensor_count()];
+    wait_fds[0].fd = fd_signal;
+    wait_fds[0].events = POLLIN;
+    wait_fds[1].fd = fd_timer;
+    wait_fds[1].events = POLLIN;
+    while ((options.sample_limit == 0) || (ticks < options.sample_limit)) {
+        uint64_t expirations;
+        int64_t timestamp_ns;
+
+        if (poll(wait_fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll() in veml6030_collector");
+            return_code = 1;
+            break;
+        }
+        if (wait_fds[0].revents & POLLIN) {
+            break;
+        }
+        if (!(wait_fds[1].revents & POLLIN) || (read(fd_timer, &expirations, sizeof(expirations)) < 0)) {
+            continue;
+        }
+
+        bus_manager.poll(&samples[0], sample_ok);
+        timestamp_ns = veml6030_monotonic_ns();
+        output.clear();
+        for (int i = 0; i < bus_manager.sensor_count(); ++i) {
+            veml6030_collector_record record;
+
+            /* Samples read while a new configuration is settling aren't valid readings. */
+            if (!sample_ok[i] || !samples[i].settled) {
+                continue;
+            }
+            make_record(samples[i], options.addresses[i], timestamp_ns, record);
+            shm_publisher.publish(i, record);
+            if (options.stream_output) {
+                format_record(record, options.binary_output, output);
+            }
+        }
+        if (!output.empty() && !write_all(fd_output, output.data(), output.size())) {
+            return_code = 1;
+            break;
+        }
+        ++ticks;
+    }
+
+    if (options.print_stats) {
+        veml6030_i2c_stats_snapshot stats_snapshot;
+
+        bus_manager.sensor(0)->get_transport()->get_stats().snapshot(stats_snapshot);
+        stats_snapshot.dump(stderr);
+    }
+    delete[] sample_ok;
+    close(fd_timer);
+    close(fd_signal);
+    if (fd_output != STDOUT_FILENO) {
+        close(fd_output);
+    }
+    return return_code;
+}
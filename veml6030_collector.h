@@ -0,0 +1,27 @@
+#ifndef _VEML6030_COLLECTOR_H_
+#define _VEML6030_COLLECTOR_H_
+
+#include <stdint.h>
+
+// Output of the headless veml6030_collector.
+//
+// The line format is one sample per line:
+//
+//   <timestamp_ns> <address> <ambient_lux> <white_lux> <ambient_bits> <white_bits> <setting_reg>
+//
+// with the address and setting register in hex. The binary format is a stream of
+// veml6030_collector_record structures in the byte order of the collecting machine.
+// Timestamps are CLOCK_MONOTONIC nanoseconds.
+struct veml6030_collector_record {
+    int64_t timestamp_ns;
+    uint8_t address;
+    uint8_t reserved;
+    uint16_t setting_reg;
+    uint16_t ambient_light_bits;
+    uint16_t white_light_bits;
+    uint32_t ambient_light_lux;
+    uint32_t white_light_lux;
+};
+
+static_assert(sizeof(veml6030_collector_record) == 24, "veml6030_collector_record must be packed to 24 bytes");
+#endif
@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <errno.h>
+
+#include "veml6030_config_solver.h"
+
+// Settings in SETTING_REG bit order, with their register encodings.
+struct gain_setting {
+    float gain;
+    uint16_t bits;
+};
+
+struct integration_time_setting {
+    uint16_t time_ms;
+    uint16_t bits;
+};
+
+static const gain_setting gain_settings[] = {{2, 1}, {1, 0}, {.25, 3}, {.125, 2}};
+static const integration_time_setting integration_time_settings[] = {
+    {25, 12}, {50, 8}, {100, 0}, {200, 1}, {400, 2}, {800, 3}};
+
+// Power save mode wait times from the datasheet, indexed by mode - 1.
+static const uint32_t power_save_wait_ms[] = {500, 1000, 2000, 4000};
+
+// Supply current in power save mode from the datasheet's refresh time and IDD
+// table, indexed by mode - 1 and by integration time 100, 200, 400 and 800ms.
+// Longer integration keeps the sensor converting for more of each cycle, so it
+// draws more. The table doesn't cover 25 and 50ms in power save mode, so those
+// are only used continuously.
+static const float power_save_current_ua[4][4] = {
+    {8, 13, 20, 28},
+    {5, 8, 13, 20},
+    {3, 5, 8, 13},
+    {2, 3, 5, 8},
+};
+
+// Supply current while converting continuously.
+static const float continuous_current_ua = 45;
+
+// Raw count the dimmest requested light must reach, the bottom of the auto range
+// band from the application note.
+static const float min_light_counts = 100;
+
+// This function returns true if candidate should be preferred over best.
+static bool better_point(const veml6030_operating_point &candidate, const veml6030_operating_point &best) {
+    if (candidate.current_ua != best.current_ua) {
+        return (candidate.current_ua < best.current_ua);
+    }
+    if (candidate.refresh_period_ms != best.refresh_period_ms) {
+        return (candidate.refresh_period_ms > best.refresh_period_ms);
+    }
+    return (candidate.lux_per_count < best.lux_per_count);
+}
+
+// This function tries every gain, integration time and power save mode, which
+// is 4 * 6 * 5 combinations, so a search is cheaper than anything clever.
+bool veml6030_solve_config(const veml6030_config_request &request, veml6030_operating_point &point) {
+    float max_refresh_period_ms = 0;
+    bool found = false;
+
+    /* Worked out in float: truncating would turn rates over 1000/s into "no limit". */
+    if (request.samples_per_second > 0) {
+        max_refresh_period_ms = 1000 / request.samples_per_second;
+        if (max_refresh_period_ms < integration_time_settings[0].time_ms) {
+            return false;
+        }
+    }
+    for (const gain_setting &gain : gain_settings) {
+        for (int it = 0; it < (int)(sizeof(integration_time_settings) / sizeof(integration_time_settings[0])); ++it) {
+            uint16_t setting_reg = (gain.bits << GAIN_POS) | (integration_time_settings[it].bits << INTEGRATION_TIME_POS);
+            veml6030_operating_point candidate;
+            uint32_t full_scale_lux;
+
+            candidate.gain = gain.gain;
+            candidate.integration_time_ms = integration_time_settings[it].time_ms;
+            candidate.lux_per_count = veml6030_conversion_for(setting_reg).lux_per_count;
+            full_scale_lux = (uint32_t)(0xFFFF * candidate.lux_per_count);
+            candidate.max_lux = (full_scale_lux > 1000) ? veml6030_lux_compensation(full_scale_lux) : full_scale_lux;
+
+            if ((request.lux_resolution > 0) && (candidate.lux_per_count > request.lux_resolution)) {
+                continue;
+            }
+            if ((request.min_lux > 0) && ((request.min_lux / candidate.lux_per_count) < min_light_counts)) {
+                continue;
+            }
+            if ((request.max_lux > 0) && (candidate.max_lux < request.max_lux)) {
+                continue;
+            }
+            for (uint16_t mode = 0; mode <= 4; ++mode) {
+                candidate.power_save_mode = mode;
+                candidate.refresh_period_ms = candidate.integration_time_ms;
+                if (mode == 0) {
+                    candidate.current_ua = continuous_current_ua;
+                } else if (candidate.integration_time_ms < 100) {
+                    continue;
+                } else {
+                    candidate.refresh_period_ms += power_save_wait_ms[mode - 1];
+                    candidate.current_ua = power_save_current_ua[mode - 1][it - 2];
+                }
+                if ((max_refresh_period_ms > 0) && (candidate.refresh_period_ms > max_refresh_period_ms)) {
+                    continue;
+                }
+                if (!found || better_point(candidate, point)) {
+                    point = candidate;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+int veml6030_configure_for(SparkFun_Ambient_Light *sensor, const veml6030_config_request &request,
+                           veml6030_operating_point &point) {
+    if (!veml6030_solve_config(request, point)) {
+        return -ERANGE;
+    }
+    sensor->disable_auto_range();
+    return sensor->set_configuration(point.gain, point.integration_time_ms, point.power_save_mode);
+}
@@ -0,0 +1,39 @@
+#ifndef _VEML6030_CONFIG_SOLVER_H_
+#define _VEML6030_CONFIG_SOLVER_H_
+
+#include <stdint.h>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+
+// What a sensor has to deliver. Any field left at 0 is not a constraint.
+struct veml6030_config_request {
+    float samples_per_second; // New readings at least this often
+    float lux_resolution;     // Lux per count no coarser than this
+    uint32_t min_lux;         // Dimmest light that must still read 100 counts
+    uint32_t max_lux;         // Brightest light that must not saturate
+};
+
+// One gain, integration time and power save mode combination, and what it gives.
+struct veml6030_operating_point {
+    float gain;
+    uint16_t integration_time_ms;
+    uint16_t power_save_mode;   // 1-4, or 0 for power save disabled
+    uint32_t refresh_period_ms; // Integration time plus the power save wait
+    float lux_per_count;
+    uint32_t max_lux;           // Compensated lux at full scale
+    float current_ua;           // Approximate supply current from the datasheet
+};
+
+// This function fills in point with the combination that meets request at the
+// lowest supply current, using the datasheet timing and current tables. Ties go
+// to the longest refresh period (fewest bus wakeups) and then the finest
+// resolution. It returns false if no combination meets the request.
+bool veml6030_solve_config(const veml6030_config_request &request, veml6030_operating_point &point);
+
+// This function solves request and applies the result to sensor with
+// SparkFun_Ambient_Light::set_configuration(), which costs at most two register
+// writes. It returns 0, -ERANGE if the request can't be met, or the negative
+// errno value of a failed write. Auto ranging, if enabled, will move off the
+// chosen gain and integration time, so it is turned off.
+int veml6030_configure_for(SparkFun_Ambient_Light *sensor, const veml6030_config_request &request,
+                           veml6030_operating_point &point);
+#endif
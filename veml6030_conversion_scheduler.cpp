@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+
+#include "veml6030_conversion_scheduler.h"
+#include "veml6030_clock.h"
+
+veml6030_conversion_scheduler::veml6030_conversion_scheduler(SparkFun_Ambient_Light *sensor)
+    : sensor(sensor),
+      cycle_start_ns(0),
+      period_ns(0),
+      margin_ns(0),
+      last_conversion(0),
+      next_sequence(0),
+      skipped(0) {
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        perror("timerfd_create() in veml6030_conversion_scheduler");
+    }
+    config_generation = sensor->get_config_generation() - 1;
+    sync_config();
+}
+
+veml6030_conversion_scheduler::~veml6030_conversion_scheduler() {
+    if (timer_fd >= 0) {
+        close(timer_fd);
+    }
+}
+
+int veml6030_conversion_scheduler::get_fd() const {
+    return timer_fd;
+}
+
+uint32_t veml6030_conversion_scheduler::get_period_ms() const {
+    return period_ns / 1000000;
+}
+
+unsigned long veml6030_conversion_scheduler::skipped_polls() const {
+    return skipped;
+}
+
+// This function picks up a configuration change. The sensor restarts its cycle
+// when it is reconfigured, so conversions complete one refresh period after the
+// change and every period after that. The timer fires a small margin after each
+// expected completion to allow for the sensor's oscillator tolerance.
+void veml6030_conversion_scheduler::sync_config() {
+    struct itimerspec timer_setting;
+    int64_t first_expiry_ns;
+
+    if (config_generation == sensor->get_config_generation()) {
+        return;
+    }
+    config_generation = sensor->get_config_generation();
+    cycle_start_ns = sensor->get_config_change_ns();
+    period_ns = (int64_t)sensor->read_refresh_period_ms() * 1000000;
+    margin_ns = period_ns / 10;
+    last_conversion = 0;
+
+    if (timer_fd < 0) {
+        return;
+    }
+    first_expiry_ns = cycle_start_ns + period_ns + margin_ns;
+    timer_setting.it_value.tv_sec = first_expiry_ns / 1000000000;
+    timer_setting.it_value.tv_nsec = first_expiry_ns % 1000000000;
+    timer_setting.it_interval.tv_sec = period_ns / 1000000000;
+    timer_setting.it_interval.tv_nsec = period_ns % 1000000000;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer_setting, NULL) < 0) {
+        perror("timerfd_settime() in veml6030_conversion_scheduler");
+    }
+}
+
+// This function returns the index of the last conversion completed by now_ns.
+int64_t veml6030_conversion_scheduler::completed_conversion(int64_t now_ns) const {
+    int64_t elapsed_ns = now_ns - cycle_start_ns - margin_ns;
+
+    if ((period_ns <= 0) || (elapsed_ns < period_ns)) {
+        return 0;
+    }
+    return elapsed_ns / period_ns;
+}
+
+// This function reads the sensor if a conversion has completed since the last read.
+bool veml6030_conversion_scheduler::poll(veml6030_sample &sample, uint32_t &sequence) {
+    int64_t conversion;
+
+    sync_config();
+    conversion = completed_conversion(veml6030_monotonic_ns());
+    if (conversion <= last_conversion) {
+        ++skipped;
+        return false;
+    }
+    if (!sensor->read_sample(sample)) {
+        return false;
+    }
+    next_sequence += (conversion - last_conversion);
+    last_conversion = conversion;
+    sequence = next_sequence;
+    return true;
+}
+
+// This function waits for the next conversion to complete and then reads it.
+bool veml6030_conversion_scheduler::read_next(veml6030_sample &sample, uint32_t &sequence) {
+    uint64_t expirations;
+
+    if (timer_fd < 0) {
+        return false;
+    }
+    sync_config();
+    while (completed_conversion(veml6030_monotonic_ns()) <= last_conversion) {
+        struct pollfd timer_poll;
+
+        timer_poll.fd = timer_fd;
+        timer_poll.events = POLLIN;
+        if ((::poll(&timer_poll, 1, -1) < 0) && (errno != EINTR)) {
+            perror("poll() in veml6030_conversion_scheduler");
+            return false;
+        }
+        /* Clear the expiration count; the conversion index comes from the clock. */
+        if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+            expirations = 0;
+        }
+    }
+    return poll(sample, sequence);
+}
@@ -0,0 +1,63 @@
+#ifndef _VEML6030_CONVERSION_SCHEDULER_H_
+#define _VEML6030_CONVERSION_SCHEDULER_H_
+
+#include <stdint.h>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+
+// Paces reads of one sensor to its conversion cycle. The sensor only updates its
+// light data registers once per refresh period (integration time plus any power
+// save wait), so reading faster just returns the previous conversion again.
+//
+// The scheduler takes the refresh period and the start of the conversion cycle
+// from the driver's cached configuration, and arms a timerfd to expire just after
+// each conversion completes. Samples are tagged with the index of the conversion
+// they came from, and polls that would only return an already read conversion are
+// dropped without touching the bus. A gap in the sequence numbers means
+// conversions were missed.
+class veml6030_conversion_scheduler {
+  public:
+    veml6030_conversion_scheduler(SparkFun_Ambient_Light *sensor);
+    ~veml6030_conversion_scheduler();
+
+    // This function returns the timerfd, which becomes readable when a new
+    // conversion has completed. It can be added to a poll or epoll set.
+    int get_fd() const;
+
+    // This function reads the sensor if a conversion has completed since the last
+    // read. It returns false without reading if not, or if the read failed. It
+    // never blocks, apart from the read itself.
+    bool poll(veml6030_sample &sample, uint32_t &sequence);
+
+    // This function waits for the next conversion to complete and then reads it.
+    // It returns false if the read failed.
+    bool read_next(veml6030_sample &sample, uint32_t &sequence);
+
+    // This function returns the current refresh period in milliseconds.
+    uint32_t get_period_ms() const;
+
+    // Number of polls dropped because they would have re-read a conversion.
+    unsigned long skipped_polls() const;
+
+  private:
+    SparkFun_Ambient_Light *sensor;
+    int timer_fd;
+    uint32_t config_generation;
+    int64_t cycle_start_ns;
+    int64_t period_ns;
+    int64_t margin_ns;
+    int64_t last_conversion;
+    uint32_t next_sequence;
+    unsigned long skipped;
+
+    // This function picks up a configuration change: it recomputes the refresh
+    // period and cycle start, and re-arms the timer.
+    void sync_config();
+
+    // This function returns the index of the last conversion completed by now_ns.
+    // The first conversion after a configuration change is number 1.
+    int64_t completed_conversion(int64_t now_ns) const;
+
+    veml6030_conversion_scheduler(const veml6030_conversion_scheduler &) = delete;
+    veml6030_conversion_scheduler &operator=(const veml6030_conversion_scheduler &) = delete;
+};
+#endif
@@ -0,0 +1,144 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_test.h"
+
+// The settings the driver takes, in the order of the datasheet conversion arrays:
+// gains by array index and integration times by array.
+static const float gains[] = {2, 1, .25, .125};
+static const uint16_t integration_times[] = {800, 400, 200, 100, 50, 25};
+static const float *const conversion_arrays[] = {eight_high_integration_time, four_high_integration_time,
+                                                 two_high_integration_time,   one_high_integration_time,
+                                                 fifty_integration_time,      twenty_integration_time};
+
+// The table gives every setting the datasheet factor, and zero for the reserved
+// integration time encodings.
+static void test_conversion_table() {
+    static const uint16_t integration_time_bits[] = {3, 2, 1, 0, 8, 12};
+    static const uint16_t gain_bits[] = {1, 0, 3, 2};
+
+    for (int g = 0; g < 4; ++g) {
+        for (uint16_t it_bits = 0; it_bits < 16; ++it_bits) {
+            uint16_t setting_reg = (gain_bits[g] << GAIN_POS) | (it_bits << INTEGRATION_TIME_POS);
+            /* The other SETTING_REG fields must not affect the lookup. */
+            const veml6030_conversion &conversion =
+                veml6030_conversion_for(setting_reg | SHUTDOWN_MASK | INTERRUPT_ENABLE_MASK | PERSISTENCE_PROTECT_MASK);
+            float expected = 0;
+
+            for (int t = 0; t < 6; ++t) {
+                if (integration_time_bits[t] == it_bits) {
+                    expected = conversion_arrays[t][g];
+                }
+            }
+            VEML6030_CHECK(conversion.lux_per_count == expected);
+            if (expected == 0) {
+                VEML6030_CHECK(conversion.counts_per_lux == 0);
+            } else {
+                VEML6030_CHECK(fabs((conversion.counts_per_lux * expected) - 1) < 1e-6);
+            }
+        }
+    }
+}
+
+// calculate_lux() and the interrupt thresholds give the same counts and lux as
+// the original per-setting compare chains, for every setting the driver takes.
+static void test_driver_conversion() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    static const uint16_t light_bits[] = {0, 1, 7, 100, 1234, 10000, 33333, 0xFFFF};
+    static const uint32_t lux_values[] = {1, 50, 999, 4000, 100000};
+
+    for (int t = 0; t < 6; ++t) {
+        for (int g = 0; g < 4; ++g) {
+            float lux_conversion = conversion_arrays[t][g];
+
+            light.set_gain(gains[g]);
+            light.set_integration_time(integration_times[t]);
+            for (size_t i = 0; i < sizeof(light_bits) / sizeof(light_bits[0]); ++i) {
+                uint32_t expected = (lux_conversion * light_bits[i]);
+
+                VEML6030_CHECK(light.calculate_lux(light_bits[i]) == expected);
+            }
+            for (size_t i = 0; i < sizeof(lux_values) / sizeof(lux_values[0]); ++i) {
+                float counts = (lux_values[i] / lux_conversion);
+                uint16_t expected = counts;
+
+                if (counts >= 0xFFFF) {
+                    continue;
+                }
+                /* A reciprocal multiply may round the other way at a count boundary. */
+                light.set_interrupt_high_threshold(lux_values[i]);
+                VEML6030_CHECK(abs((int)light.read_register_checked(H_THRESHOLD_REG).value - (int)expected) <= 1);
+            }
+        }
+    }
+}
+
+// This function is the compensation as the driver first had it, with pow().
+static uint32_t reference_compensation(uint32_t lux_value) {
+    uint32_t compensated_lux = (.00000000000060135 * (pow(lux_value, 4))) - (.0000000093924 * (pow(lux_value, 3))) +
+                               (.000081488 * (pow(lux_value, 2))) + (1.0023 * lux_value);
+    return compensated_lux;
+}
+
+// The Horner form stays within 1 lux of the pow() formula and the fixed point
+// version within 6 lux of the Horner form, over the sensor's whole range.
+static void test_compensation() {
+    int horner_errors = 0;
+    int fixed_errors = 0;
+
+    for (uint32_t lux_value = 1000; lux_value <= 120000; ++lux_value) {
+        int64_t compensated = veml6030_lux_compensation(lux_value);
+
+        if (llabs(compensated - (int64_t)reference_compensation(lux_value)) > 1) {
+            ++horner_errors;
+        }
+        if (llabs((int64_t)veml6030_lux_compensation_fixed(lux_value) - compensated) > 6) {
+            ++fixed_errors;
+        }
+    }
+    VEML6030_CHECK(horner_errors == 0);
+    VEML6030_CHECK(fixed_errors == 0);
+}
+
+// With the lux table on, every count converts to exactly what calculate_lux()
+// and lux_compensation() give, and the table follows range changes.
+static void test_lux_table() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    static const float table_gains[] = {.125, 1, 2};
+    static const uint16_t table_integration_times[] = {25, 100, 800};
+    veml6030_sample sample;
+
+    light.enable_lux_table();
+    for (int s = 0; s < 3; ++s) {
+        int mismatches = 0;
+
+        light.set_gain(table_gains[s]);
+        light.set_integration_time(table_integration_times[s]);
+        for (uint32_t light_bits = 0; light_bits <= 0xFFFF; ++light_bits) {
+            uint32_t expected = light.calculate_lux(light_bits);
+
+            if (expected > 1000) {
+                expected = light.lux_compensation(expected);
+            }
+            transport.set_register(0x48, AMBIENT_LIGHT_DATA_REG, light_bits);
+            if (!light.read_sample(sample) || (sample.ambient_light_lux != expected)) {
+                ++mismatches;
+            }
+        }
+        VEML6030_CHECK(mismatches == 0);
+    }
+    light.disable_lux_table();
+}
+
+int main() {
+    test_conversion_table();
+    test_driver_conversion();
+    test_compensation();
+    test_lux_table();
+    return veml6030_test_result();
+}
@@ -0,0 +1,112 @@
+#include <stdint.h>
+#include <unistd.h>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_test.h"
+
+// This function reads a sample and returns whether it was settled.
+static bool read_settled(SparkFun_Ambient_Light &light) {
+    veml6030_sample sample;
+
+    VEML6030_CHECK(light.read_sample(sample));
+    return sample.settled;
+}
+
+// Every configuration change that reaches the sensor starts a settling period of
+// two conversions, whichever function made it. Rewriting the same value, or
+// changing bits that don't affect timing, doesn't.
+static void test_settling() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+
+    /* At 25ms two conversions and the margin take 52.5ms. */
+    light.set_integration_time(25);
+    VEML6030_CHECK(!read_settled(light));
+    usleep(60000);
+    VEML6030_CHECK(read_settled(light));
+
+    light.set_gain(2);
+    VEML6030_CHECK(!read_settled(light));
+    usleep(60000);
+    VEML6030_CHECK(read_settled(light));
+
+    light.set_gain(2);
+    VEML6030_CHECK(read_settled(light));
+
+    VEML6030_CHECK(light.set_configuration(.125, 25, 0) == 0);
+    VEML6030_CHECK(!read_settled(light));
+    usleep(60000);
+    VEML6030_CHECK(read_settled(light));
+
+    VEML6030_CHECK(light.write_register_checked(SETTING_REG, light.read_register_checked(SETTING_REG).value) == 0);
+    VEML6030_CHECK(read_settled(light));
+
+    /* Interrupt and persistence bits don't affect the conversions. */
+    light.enable_interrupt();
+    light.set_protect(4);
+    VEML6030_CHECK(read_settled(light));
+}
+
+// This function sets the simulated ambient count and returns the next sample.
+static veml6030_sample read_counts(fake_veml6030_transport &transport, SparkFun_Ambient_Light &light,
+                                   uint16_t counts) {
+    veml6030_sample sample;
+
+    transport.set_register(0x48, AMBIENT_LIGHT_DATA_REG, counts);
+    VEML6030_CHECK(light.read_sample(sample));
+    return sample;
+}
+
+// Auto ranging leaves counts inside the band alone, jumps straight to the range
+// that puts the estimated light near the target, waits for settling before
+// judging the new range, and drops to the least sensitive range on saturation.
+static void test_auto_range() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+
+    light.set_gain(.125);
+    light.set_integration_time(25);
+    usleep(60000);
+    light.enable_auto_range();
+    VEML6030_CHECK(light.read_auto_range_enabled());
+
+    transport.reset_counts();
+    VEML6030_CHECK(read_counts(transport, light, 2000).settled);
+    VEML6030_CHECK(transport.write_count() == 0);
+
+    /* 50 counts at 1.8432 lux each is 3200 counts at gain 2, 100ms. */
+    VEML6030_CHECK(read_counts(transport, light, 50).settled);
+    VEML6030_CHECK(light.read_gain() == 2);
+    VEML6030_CHECK(light.read_integtration_time() == 100);
+    VEML6030_CHECK(transport.write_count() == 1);
+
+    veml6030_sample sample = read_counts(transport, light, 0xFFFF);
+    VEML6030_CHECK(!sample.settled);
+    VEML6030_CHECK(light.read_gain() == 2);
+
+    /* Two 100ms conversions and the margin. */
+    usleep(220000);
+    sample = read_counts(transport, light, 0xFFFF);
+    VEML6030_CHECK(sample.settled);
+    /* The saturated sample was converted with the range it was read in. */
+    VEML6030_CHECK((sample.setting_reg & GAIN_MASK) == (1 << GAIN_POS));
+    VEML6030_CHECK(light.read_gain() == .125);
+    VEML6030_CHECK(light.read_integtration_time() == 25);
+
+    /* Nothing is less sensitive than 1/8 at 25ms. */
+    usleep(60000);
+    transport.reset_counts();
+    VEML6030_CHECK(read_counts(transport, light, 20000).settled);
+    VEML6030_CHECK(transport.write_count() == 0);
+
+    light.disable_auto_range();
+    VEML6030_CHECK(read_counts(transport, light, 50).settled);
+    VEML6030_CHECK(transport.write_count() == 0);
+}
+
+int main() {
+    test_settling();
+    test_auto_range();
+    return veml6030_test_result();
+}
@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "veml6030_executor.h"
+#include "veml6030_clock.h"
+
+veml6030_executor::veml6030_executor()
+    : stopping(false),
+      next_timer_id(1),
+      armed_deadline_ns(0) {
+    struct epoll_event event;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((epoll_fd < 0) || (timer_fd < 0) || (stop_fd < 0)) {
+        perror("epoll_create1()/timerfd_create()/eventfd() in veml6030_executor");
+        return;
+    }
+    event.events = EPOLLIN;
+    event.data.fd = timer_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+    event.events = EPOLLIN;
+    event.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+}
+
+veml6030_executor::~veml6030_executor() {
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+    if (timer_fd >= 0) {
+        close(timer_fd);
+    }
+    if (stop_fd >= 0) {
+        close(stop_fd);
+    }
+}
+
+bool veml6030_executor::is_valid() const {
+    return ((epoll_fd >= 0) && (timer_fd >= 0) && (stop_fd >= 0));
+}
+
+veml6030_executor::timer_id veml6030_executor::call_at(int64_t deadline_ns, timer_callback callback) {
+    timer_entry entry;
+
+    entry.deadline_ns = deadline_ns;
+    entry.id = next_timer_id++;
+    timer_queue.push(entry);
+    timers[entry.id] = callback;
+    if ((armed_deadline_ns == 0) || (deadline_ns < armed_deadline_ns)) {
+        arm_timer();
+    }
+    return entry.id;
+}
+
+veml6030_executor::timer_id veml6030_executor::call_after(int64_t delay_ns, timer_callback callback) {
+    return call_at(veml6030_monotonic_ns() + delay_ns, callback);
+}
+
+// This function forgets the timer's callback. Its heap entry is dropped when it
+// reaches the top, which keeps cancel() O(1).
+bool veml6030_executor::cancel(timer_id id) {
+    return (timers.erase(id) > 0);
+}
+
+bool veml6030_executor::watch_fd(int fd, uint32_t events, fd_callback callback) {
+    struct epoll_event event;
+    bool watched = (fd_watches.find(fd) != fd_watches.end());
+
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0) {
+        perror("epoll_ctl() in veml6030_executor");
+        return false;
+    }
+    fd_watches[fd] = callback;
+    return true;
+}
+
+void veml6030_executor::unwatch_fd(int fd) {
+    if (fd_watches.erase(fd) > 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+}
+
+size_t veml6030_executor::pending_timers() const {
+    return timers.size();
+}
+
+// This function arms the timerfd for the earliest timer that hasn't been
+// cancelled, or disarms it if there is none.
+void veml6030_executor::arm_timer() {
+    struct itimerspec timer_setting;
+
+    while (!timer_queue.empty() && (timers.find(timer_queue.top().id) == timers.end())) {
+        timer_queue.pop();
+    }
+    timer_setting.it_interval.tv_sec = 0;
+    timer_setting.it_interval.tv_nsec = 0;
+    if (timer_queue.empty()) {
+        armed_deadline_ns = 0;
+        timer_setting.it_value.tv_sec = 0;
+        timer_setting.it_value.tv_nsec = 0;
+    } else {
+        armed_deadline_ns = timer_queue.top().deadline_ns;
+        if (armed_deadline_ns <= 0) {
+            armed_deadline_ns = 1;
+        }
+        timer_setting.it_value.tv_sec = armed_deadline_ns / 1000000000;
+        timer_setting.it_value.tv_nsec = armed_deadline_ns % 1000000000;
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer_setting, NULL);
+}
+
+// This function runs the timers that are due. Each callback is taken out of the
+// table before it runs, so it can safely schedule or cancel timers itself.
+int veml6030_executor::run_due_timers() {
+    int64_t now_ns = veml6030_monotonic_ns();
+    int callbacks_run = 0;
+
+    while (!timer_queue.empty() && (timer_queue.top().deadline_ns <= now_ns)) {
+        timer_id id = timer_queue.top().id;
+        std::unordered_map<timer_id, timer_callback>::iterator timer = timers.find(id);
+        timer_callback callback;
+
+        timer_queue.pop();
+        if (timer == timers.end()) {
+            continue;
+        }
+        callback.swap(timer->second);
+        timers.erase(timer);
+        callback();
+        ++callbacks_run;
+    }
+    arm_timer();
+    return callbacks_run;
+}
+
+int veml6030_executor::run_once(int timeout_ms) {
+    static const int max_events = 32;
+    struct epoll_event events[max_events];
+    uint64_t expirations;
+    int event_count;
+    int callbacks_run = 0;
+
+    event_count = epoll_wait(epoll_fd, events, max_events, timeout_ms);
+    if (event_count < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        perror("epoll_wait() in veml6030_executor");
+        return -1;
+    }
+    for (int i = 0; i < event_count; ++i) {
+        int fd = events[i].data.fd;
+
+        if (fd == timer_fd) {
+            if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+                expirations = 0;
+            }
+        } else if (fd == stop_fd) {
+            if (read(stop_fd, &expirations, sizeof(expirations)) < 0) {
+                expirations = 0;
+            }
+        } else {
+            std::unordered_map<int, fd_callback>::iterator watch = fd_watches.find(fd);
+
+            /* A copy, since the callback may unwatch (and so destroy) itself. */
+            if (watch != fd_watches.end()) {
+                fd_callback callback = watch->second;
+
+                callback(events[i].events);
+                ++callbacks_run;
+            }
+        }
+    }
+    return callbacks_run + run_due_timers();
+}
+
+// This function runs until a stop request is seen. The request is only cleared
+// on the way out, so a stop() made before run() is reached (say by a thread
+// that hasn't been scheduled yet) still ends it, and the executor can be run
+// again afterwards.
+void veml6030_executor::run() {
+    uint64_t stop_count;
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (run_once(-1) < 0) {
+            break;
+        }
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    if (read(stop_fd, &stop_count, sizeof(stop_count)) < 0) {
+        stop_count = 0;
+    }
+}
+
+void veml6030_executor::stop() {
+    uint64_t stop_count = 1;
+
+    stopping.store(true, std::memory_order_release);
+    if (write(stop_fd, &stop_count, sizeof(stop_count)) < 0) {
+        perror("write() of stop request in veml6030_executor");
+    }
+}
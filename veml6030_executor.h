@@ -0,0 +1,92 @@
+#ifndef _VEML6030_EXECUTOR_H_
+#define _VEML6030_EXECUTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Single threaded callback executor built on epoll and one timerfd. Timers are
+// kept in a heap and the timerfd is armed for the earliest one, so any number
+// of pending timers costs one file descriptor. File descriptors (a GPIO line, a
+// socket, a conversion scheduler's timerfd) can be watched in the same loop.
+//
+// Callbacks run on the thread calling run() or run_once() and may add or cancel
+// timers and watches, including their own. Only stop() may be called from
+// another thread.
+class veml6030_executor {
+  public:
+    typedef uint64_t timer_id;
+    typedef std::function<void()> timer_callback;
+    typedef std::function<void(uint32_t events)> fd_callback;
+
+    veml6030_executor();
+    ~veml6030_executor();
+
+    // This function returns false if the epoll or timer setup failed.
+    bool is_valid() const;
+
+    // These functions run callback once, at the CLOCK_MONOTONIC time deadline_ns
+    // or after delay_ns. They return an id for cancel().
+    timer_id call_at(int64_t deadline_ns, timer_callback callback);
+    timer_id call_after(int64_t delay_ns, timer_callback callback);
+
+    // This function cancels a timer that hasn't run yet. It returns false if
+    // there was no such timer.
+    bool cancel(timer_id id);
+
+    // This function calls callback with the epoll events (EPOLLIN etc.) whenever
+    // fd is ready. It returns false if fd couldn't be added.
+    bool watch_fd(int fd, uint32_t events, fd_callback callback);
+    void unwatch_fd(int fd);
+
+    // This function waits up to timeout_ms (-1 for ever) for a timer or watched
+    // fd, runs whatever is due and returns the number of callbacks run, or -1 if
+    // waiting failed.
+    int run_once(int timeout_ms = -1);
+
+    // This function runs callbacks until stop() is called. If stop() was called
+    // before run() started, run() returns at once.
+    void run();
+
+    // This function makes run() return. It can be called from any thread, even
+    // before the thread that calls run() has got there.
+    void stop();
+
+    // Number of timers waiting to run.
+    size_t pending_timers() const;
+
+  private:
+    struct timer_entry {
+        int64_t deadline_ns;
+        timer_id id;
+
+        bool operator>(const timer_entry &other) const {
+            return (deadline_ns > other.deadline_ns) ||
+                   ((deadline_ns == other.deadline_ns) && (id > other.id));
+        }
+    };
+
+    int epoll_fd;
+    int timer_fd;
+    int stop_fd;
+    std::atomic<bool> stopping;
+    timer_id next_timer_id;
+    int64_t armed_deadline_ns;
+    std::priority_queue<timer_entry, std::vector<timer_entry>, std::greater<timer_entry> > timer_queue;
+    std::unordered_map<timer_id, timer_callback> timers;
+    std::unordered_map<int, fd_callback> fd_watches;
+
+    // This function arms the timerfd for the earliest pending timer.
+    void arm_timer();
+
+    // This function runs the timers whose deadline has passed and returns how many ran.
+    int run_due_timers();
+
+    veml6030_executor(const veml6030_executor &) = delete;
+    veml6030_executor &operator=(const veml6030_executor &) = delete;
+};
+#endif
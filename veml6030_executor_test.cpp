@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <thread>
+#include <vector>
+
+#include "veml6030_clock.h"
+#include "veml6030_executor.h"
+#include "veml6030_test.h"
+
+// A stop() made right after starting the thread, before it has reached run(),
+// still ends the run; and the executor can be run again afterwards.
+static void test_stop_right_after_start() {
+    for (int i = 0; i < 100; ++i) {
+        veml6030_executor executor;
+        std::thread runner(&veml6030_executor::run, &executor);
+
+        executor.stop();
+        runner.join();
+    }
+
+    veml6030_executor executor;
+    executor.stop();
+    executor.run();
+    executor.call_after(1000000, [&executor]() { executor.stop(); });
+    executor.run();
+    VEML6030_CHECK(executor.pending_timers() == 0);
+}
+
+// Timers run in deadline order, and cancelled ones don't run.
+static void test_timers() {
+    veml6030_executor executor;
+    std::vector<int> order;
+    veml6030_executor::timer_id cancelled;
+    int64_t now_ns = veml6030_monotonic_ns();
+
+    VEML6030_CHECK(executor.is_valid());
+    executor.call_at(now_ns + 3000000, [&order]() { order.push_back(3); });
+    executor.call_at(now_ns + 1000000, [&order]() { order.push_back(1); });
+    cancelled = executor.call_at(now_ns + 2000000, [&order]() { order.push_back(2); });
+    executor.call_at(now_ns + 4000000, [&executor]() { executor.stop(); });
+    VEML6030_CHECK(executor.cancel(cancelled));
+    VEML6030_CHECK(!executor.cancel(cancelled));
+    executor.run();
+    VEML6030_CHECK((order.size() == 2) && (order[0] == 1) && (order[1] == 3));
+    VEML6030_CHECK(veml6030_monotonic_ns() >= (now_ns + 4000000));
+}
+
+// A watched fd's callback runs when it is ready, and can unwatch itself.
+static void test_fd_watch() {
+    veml6030_executor executor;
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    uint64_t one = 1;
+    int calls = 0;
+
+    VEML6030_CHECK(executor.watch_fd(event_fd, EPOLLIN, [&](uint32_t events) {
+        uint64_t count;
+
+        ++calls;
+        VEML6030_CHECK(events & EPOLLIN);
+        VEML6030_CHECK(read(event_fd, &count, sizeof(count)) == sizeof(count));
+        executor.unwatch_fd(event_fd);
+    }));
+    VEML6030_CHECK(executor.run_once(0) == 0);
+    VEML6030_CHECK(write(event_fd, &one, sizeof(one)) == sizeof(one));
+    VEML6030_CHECK(executor.run_once(100) == 1);
+    VEML6030_CHECK(write(event_fd, &one, sizeof(one)) == sizeof(one));
+    VEML6030_CHECK(executor.run_once(0) == 0);
+    VEML6030_CHECK(calls == 1);
+    close(event_fd);
+}
+
+int main() {
+    test_stop_right_after_start();
+    test_timers();
+    test_fd_watch();
+    return veml6030_test_result();
+}
@@ -0,0 +1,185 @@
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "veml6030_fake_transport.h"
+
+fake_veml6030_transport::fake_veml6030_transport() {
+    memset(device_present, 0, sizeof(device_present));
+    memset(registers, 0, sizeof(registers));
+    reads = 0;
+    writes = 0;
+    transaction_latency_ns = 0;
+    injected_failures = 0;
+    injected_error = 0;
+    reopens = 0;
+}
+
+fake_veml6030_transport::fake_veml6030_transport(int slave_address) : fake_veml6030_transport() {
+    add_device(slave_address);
+}
+
+void fake_veml6030_transport::add_device(int slave_address) {
+    if ((slave_address >= 0) && (slave_address < address_count)) {
+        device_present[slave_address] = true;
+        memset(registers[slave_address], 0, sizeof(registers[slave_address]));
+        /* The sensor powers up shut down. */
+        registers[slave_address][SETTING_REG] = SHUTDOWN;
+    }
+}
+
+void fake_veml6030_transport::set_register(int slave_address, VEML6030_16BIT_REGISTERS reg, uint16_t reg_value) {
+    if (check_access(slave_address, reg) == 0) {
+        registers[slave_address][reg] = reg_value;
+    }
+}
+
+uint16_t fake_veml6030_transport::get_register(int slave_address, VEML6030_16BIT_REGISTERS reg) const {
+    if (check_access(slave_address, reg) == 0) {
+        return registers[slave_address][reg];
+    }
+    return 0xffff;
+}
+
+unsigned long fake_veml6030_transport::read_count() const {
+    return reads;
+}
+
+unsigned long fake_veml6030_transport::write_count() const {
+    return writes;
+}
+
+void fake_veml6030_transport::reset_counts() {
+    reads = 0;
+    writes = 0;
+}
+
+void fake_veml6030_transport::remove_device(int slave_address) {
+    if ((slave_address >= 0) && (slave_address < address_count)) {
+        device_present[slave_address] = false;
+    }
+}
+
+void fake_veml6030_transport::set_transaction_latency_ns(int64_t latency_ns) {
+    transaction_latency_ns = latency_ns;
+}
+
+void fake_veml6030_transport::inject_failures(int failure_count, int error) {
+    injected_failures = failure_count;
+    injected_error = error;
+}
+
+int fake_veml6030_transport::take_injected_failure() {
+    if (injected_failures <= 0) {
+        return 0;
+    }
+    --injected_failures;
+    return injected_error;
+}
+
+int fake_veml6030_transport::reopen() {
+    ++reopens;
+    return 0;
+}
+
+unsigned long fake_veml6030_transport::reopen_count() const {
+    return reopens;
+}
+
+// This function returns the start time of a transaction, reading the clock only
+// if latency is being simulated or statistics are kept.
+int64_t fake_veml6030_transport::transaction_start() const {
+    return (transaction_latency_ns > 0) ? veml6030_monotonic_ns() : stats.transaction_start();
+}
+
+void fake_veml6030_transport::simulate_latency(int64_t start_ns) const {
+    if (transaction_latency_ns > 0) {
+        while ((veml6030_monotonic_ns() - start_ns) < transaction_latency_ns) {
+        }
+    }
+}
+
+int fake_veml6030_transport::read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value) {
+    int64_t start_ns = transaction_start();
+    int return_code;
+
+    ++reads;
+    stats.record_read(read_reg);
+    return_code = take_injected_failure();
+    if (return_code == 0) {
+        return_code = access_register(slave_address, read_reg, reg_value);
+    }
+    simulate_latency(start_ns);
+    stats.record_transaction(start_ns, return_code);
+    return return_code;
+}
+
+int fake_veml6030_transport::read_registers(veml6030_register_read *reads, int read_count) {
+    int64_t start_ns = transaction_start();
+    int batch_status = take_injected_failure();
+
+    ++this->reads;
+    /* The whole batch is one transaction, so a NAK from any device fails all of it. */
+    for (int i = 0; i < read_count; ++i) {
+        stats.record_read(reads[i].reg);
+        if (batch_status == 0) {
+            batch_status = check_access(reads[i].slave_address, reads[i].reg);
+        }
+    }
+    for (int i = 0; i < read_count; ++i) {
+        if (batch_status < 0) {
+            reads[i].status = batch_status;
+        } else {
+            reads[i].status = access_register(reads[i].slave_address, reads[i].reg, reads[i].reg_value);
+        }
+    }
+    simulate_latency(start_ns);
+    stats.record_transaction(start_ns, batch_status);
+    return batch_status;
+}
+
+int fake_veml6030_transport::write_register(int slave_address, uint8_t write_reg, uint16_t reg_value) {
+    int64_t start_ns = transaction_start();
+    int return_code;
+
+    ++writes;
+    stats.record_write(write_reg);
+    return_code = take_injected_failure();
+    if (return_code == 0) {
+        return_code = check_access(slave_address, write_reg);
+    }
+    if ((return_code == 0) && (write_reg > POWER_SAVE_REG)) {
+        /* The data and status registers are read only. */
+        return_code = -EIO;
+    }
+    if (return_code == 0) {
+        registers[slave_address][write_reg] = reg_value;
+    }
+    simulate_latency(start_ns);
+    stats.record_transaction(start_ns, return_code);
+    return return_code;
+}
+
+int fake_veml6030_transport::check_access(int slave_address, uint8_t reg) const {
+    if ((slave_address < 0) || (slave_address >= address_count) || !device_present[slave_address]) {
+        return -ENXIO;
+    }
+    if (reg >= register_count) {
+        return -EIO;
+    }
+    return 0;
+}
+
+int fake_veml6030_transport::access_register(int slave_address, uint8_t read_reg, uint16_t &reg_value) {
+    int return_code;
+
+    return_code = check_access(slave_address, read_reg);
+    if (return_code < 0) {
+        return return_code;
+    }
+    reg_value = registers[slave_address][read_reg];
+    if (read_reg == INTERRUPT_STATUS_REG) {
+        registers[slave_address][read_reg] = 0;
+    }
+    return 0;
+}
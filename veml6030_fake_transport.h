@@ -0,0 +1,84 @@
+#ifndef _VEML6030_FAKE_TRANSPORT_H_
+#define _VEML6030_FAKE_TRANSPORT_H_
+
+#include <stdint.h>
+#include "veml6030_transport.h"
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+
+// In-process transport with a register file for each simulated VEML6030. It
+// needs no hardware, so it is used to exercise and benchmark the driver. Reads
+// of the interrupt status register clear it, the way the sensor does.
+class fake_veml6030_transport : public veml6030_transport {
+  public:
+    fake_veml6030_transport();
+
+    // This constructor starts with one sensor at slave_address, so a driver can
+    // be constructed on the transport straight away.
+    explicit fake_veml6030_transport(int slave_address);
+
+    // This function makes a sensor answer at slave_address. Accesses to any other
+    // address fail with -ENXIO, like a NAK'd address on a real bus.
+    void add_device(int slave_address);
+
+    // This function makes the sensor at slave_address stop answering, as if it
+    // had been unplugged. Its registers are kept.
+    void remove_device(int slave_address);
+
+    // These functions read and write the simulated sensor's registers directly,
+    // without counting as bus transactions.
+    void set_register(int slave_address, VEML6030_16BIT_REGISTERS reg, uint16_t reg_value);
+    uint16_t get_register(int slave_address, VEML6030_16BIT_REGISTERS reg) const;
+
+    // Number of bus transactions performed through the transport interface. A
+    // batch from read_registers() counts as one read, like one ioctl would, and
+    // like one ioctl it fails as a whole if any device in it doesn't answer.
+    unsigned long read_count() const;
+    unsigned long write_count() const;
+    void reset_counts();
+
+    // This function makes every transaction take at least latency_ns, the way a
+    // real bus does (about 200us for a register read at 100kHz). The time is
+    // spent busy waiting, so it is accurate down to well under a microsecond.
+    void set_transaction_latency_ns(int64_t latency_ns);
+
+    // This function makes the next failure_count transactions fail with the
+    // negative errno value error, to exercise error handling.
+    void inject_failures(int failure_count, int error);
+
+    // This function pretends to reopen the bus and counts how often it was done.
+    int reopen();
+    unsigned long reopen_count() const;
+
+    int read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value);
+    int write_register(int slave_address, uint8_t write_reg, uint16_t reg_value);
+    int read_registers(veml6030_register_read *reads, int read_count);
+
+  private:
+    static const int address_count = 128;
+    static const int register_count = INTERRUPT_STATUS_REG + 1;
+
+    bool device_present[address_count];
+    uint16_t registers[address_count][register_count];
+    unsigned long reads;
+    unsigned long writes;
+    int64_t transaction_latency_ns;
+    int injected_failures;
+    int injected_error;
+    unsigned long reopens;
+
+    // This function returns the start time of a transaction.
+    int64_t transaction_start() const;
+
+    // This function waits out the simulated bus time of a transaction that began at start_ns.
+    void simulate_latency(int64_t start_ns) const;
+
+    // This function returns the injected error if one is pending, otherwise 0.
+    int take_injected_failure();
+
+    // This function returns 0 if slave_address and reg name a simulated register.
+    int check_access(int slave_address, uint8_t reg) const;
+
+    // This function reads a simulated register without counting a transaction.
+    int access_register(int slave_address, uint8_t read_reg, uint16_t &reg_value);
+};
+#endif
@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+#include "veml6030_filter.h"
+
+// Scale that makes the median absolute deviation estimate the standard
+// deviation of normally distributed noise.
+static const double mad_to_sigma = 1.4826;
+
+veml6030_sorted_window::veml6030_sorted_window(size_t window_size)
+    : window_size((window_size > 0) ? window_size : 1),
+      arrivals(),
+      oldest(0),
+      sorted(),
+      deviations() {
+    arrivals.reserve(this->window_size);
+    sorted.reserve(this->window_size);
+    deviations.reserve(this->window_size);
+}
+
+// This function keeps the sorted copy in step with the ring: the retired value
+// is found by binary search and the new one inserted in order, both O(window)
+// moves within the reserved space.
+void veml6030_sorted_window::push(double value) {
+    if (arrivals.size() < window_size) {
+        arrivals.push_back(value);
+    } else {
+        sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), arrivals[oldest]));
+        arrivals[oldest] = value;
+        oldest = (oldest + 1) % window_size;
+    }
+    sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+}
+
+void veml6030_sorted_window::clear() {
+    arrivals.clear();
+    sorted.clear();
+    oldest = 0;
+}
+
+size_t veml6030_sorted_window::size() const {
+    return sorted.size();
+}
+
+double veml6030_sorted_window::median() const {
+    size_t middle = sorted.size() / 2;
+
+    if ((sorted.size() & 1) == 0) {
+        return (sorted[middle - 1] + sorted[middle]) / 2;
+    }
+    return sorted[middle];
+}
+
+double veml6030_sorted_window::median_absolute_deviation() {
+    double center = median();
+    size_t middle;
+
+    deviations.clear();
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        deviations.push_back(fabs(sorted[i] - center));
+    }
+    middle = deviations.size() / 2;
+    std::nth_element(deviations.begin(), deviations.begin() + middle, deviations.end());
+    return deviations[middle];
+}
+
+veml6030_ema_filter::veml6030_ema_filter(int64_t time_constant_ns)
+    : time_constant_ns((time_constant_ns > 0) ? time_constant_ns : 1),
+      primed(false),
+      last_timestamp_ns(0),
+      average(0) {
+}
+
+// This function weights each value by 1 - exp(-dt / time constant), which is
+// what a continuous RC filter would do over the time since the previous value.
+void veml6030_ema_filter::process(veml6030_filter_point *points, size_t point_count) {
+    for (size_t i = 0; i < point_count; ++i) {
+        if (!points[i].valid) {
+            continue;
+        }
+        if (!primed) {
+            average = points[i].value;
+            primed = true;
+        } else {
+            int64_t elapsed_ns = points[i].timestamp_ns - last_timestamp_ns;
+            double weight = (elapsed_ns > 0) ? (1 - exp(-elapsed_ns / time_constant_ns)) : 0;
+
+            average += weight * (points[i].value - average);
+        }
+        last_timestamp_ns = points[i].timestamp_ns;
+        points[i].value = average;
+    }
+}
+
+void veml6030_ema_filter::reset() {
+    primed = false;
+}
+
+veml6030_median_filter::veml6030_median_filter(size_t window_size) : window(window_size) {
+}
+
+void veml6030_median_filter::process(veml6030_filter_point *points, size_t point_count) {
+    for (size_t i = 0; i < point_count; ++i) {
+        if (!points[i].valid) {
+            continue;
+        }
+        window.push(points[i].value);
+        points[i].value = window.median();
+    }
+}
+
+void veml6030_median_filter::reset() {
+    window.clear();
+}
+
+veml6030_outlier_filter::veml6030_outlier_filter(size_t window_size, double threshold, double min_deviation)
+    : window(window_size),
+      threshold(threshold),
+      min_deviation(min_deviation),
+      rejected(0) {
+}
+
+// This function tests each value against the window before it, so an outlier
+// can't widen the band it is judged by.
+void veml6030_outlier_filter::process(veml6030_filter_point *points, size_t point_count) {
+    for (size_t i = 0; i < point_count; ++i) {
+        if (!points[i].valid) {
+            continue;
+        }
+        if (window.size() > 2) {
+            double deviation = fabs(points[i].value - window.median());
+            double limit = threshold * mad_to_sigma * window.median_absolute_deviation();
+
+            if ((deviation > limit) && (deviation > min_deviation)) {
+                points[i].valid = false;
+                ++rejected;
+            }
+        }
+        window.push(points[i].value);
+    }
+}
+
+void veml6030_outlier_filter::reset() {
+    window.clear();
+}
+
+unsigned long veml6030_outlier_filter::rejected_count() const {
+    return rejected;
+}
+
+veml6030_kalman_filter::veml6030_kalman_filter(double process_variance, double measurement_variance)
+    : process_variance(process_variance),
+      measurement_variance(measurement_variance),
+      primed(false),
+      last_timestamp_ns(0),
+      estimate(0),
+      estimate_variance(0) {
+}
+
+// This function predicts the level forward to each value (the variance grows
+// with the time since the last one) and then corrects it by the Kalman gain.
+void veml6030_kalman_filter::process(veml6030_filter_point *points, size_t point_count) {
+    for (size_t i = 0; i < point_count; ++i) {
+        double gain;
+
+        if (!points[i].valid) {
+            continue;
+        }
+        if (!primed) {
+            estimate = points[i].value;
+            estimate_variance = measurement_variance;
+            primed = true;
+        } else {
+            int64_t elapsed_ns = points[i].timestamp_ns - last_timestamp_ns;
+
+            if (elapsed_ns > 0) {
+                estimate_variance += process_variance * (elapsed_ns / 1e9);
+            }
+            gain = estimate_variance / (estimate_variance + measurement_variance);
+            estimate += gain * (points[i].value - estimate);
+            estimate_variance *= (1 - gain);
+        }
+        last_timestamp_ns = points[i].timestamp_ns;
+        points[i].value = estimate;
+    }
+}
+
+void veml6030_kalman_filter::reset() {
+    primed = false;
+}
+
+double veml6030_kalman_filter::get_estimate_variance() const {
+    return estimate_variance;
+}
+
+veml6030_filter_pipeline::veml6030_filter_pipeline() : stages() {
+}
+
+void veml6030_filter_pipeline::add_stage(veml6030_filter_stage *stage) {
+    stages.push_back(stage);
+}
+
+void veml6030_filter_pipeline::process(veml6030_filter_point *points, size_t point_count) {
+    for (size_t i = 0; i < stages.size(); ++i) {
+        stages[i]->process(points, point_count);
+    }
+}
+
+void veml6030_filter_pipeline::reset() {
+    for (size_t i = 0; i < stages.size(); ++i) {
+        stages[i]->reset();
+    }
+}
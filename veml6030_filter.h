@@ -0,0 +1,149 @@
+#ifndef _VEML6030_FILTER_H_
+#define _VEML6030_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// A timestamped value passing through a filter pipeline. A stage that rejects a
+// point clears valid, and later stages leave it alone.
+struct veml6030_filter_point {
+    int64_t timestamp_ns;
+    double value;
+    bool valid;
+};
+
+// One stage of a filter pipeline. Stages work on batches in place, so there is
+// one virtual call per batch rather than per sample, and all their state is
+// allocated when they are constructed.
+class veml6030_filter_stage {
+  public:
+    virtual ~veml6030_filter_stage() {}
+
+    // This function filters point_count points in place, in time order.
+    virtual void process(veml6030_filter_point *points, size_t point_count) = 0;
+
+    // This function forgets the stage's history, as if no points had been seen.
+    virtual void reset() = 0;
+};
+
+// The last window_size values in arrival order and in sorted order, for the
+// order statistics used by the median and outlier stages. Both are fixed size
+// rings or reserved vectors, so a push doesn't allocate.
+class veml6030_sorted_window {
+  public:
+    veml6030_sorted_window(size_t window_size);
+
+    // This function adds a value, retiring the one window_size pushes ago.
+    void push(double value);
+
+    void clear();
+    size_t size() const;
+
+    // This function returns the median of the window. It must not be empty.
+    double median() const;
+
+    // This function returns the median absolute deviation from the median.
+    double median_absolute_deviation();
+
+  private:
+    size_t window_size;
+    std::vector<double> arrivals; // Ring in arrival order
+    size_t oldest;
+    std::vector<double> sorted;
+    std::vector<double> deviations; // Scratch space for median_absolute_deviation()
+};
+
+// Exponential moving average with a time constant rather than a fixed weight,
+// so irregular sample spacing (missed conversions, a changed integration time)
+// doesn't change how much smoothing is applied.
+class veml6030_ema_filter : public veml6030_filter_stage {
+  public:
+    veml6030_ema_filter(int64_t time_constant_ns);
+
+    void process(veml6030_filter_point *points, size_t point_count);
+    void reset();
+
+  private:
+    double time_constant_ns;
+    bool primed;
+    int64_t last_timestamp_ns;
+    double average;
+};
+
+// Median of the last window_size values. It removes isolated spikes while
+// keeping steps sharp, at the cost of window_size / 2 samples of delay.
+class veml6030_median_filter : public veml6030_filter_stage {
+  public:
+    veml6030_median_filter(size_t window_size);
+
+    void process(veml6030_filter_point *points, size_t point_count);
+    void reset();
+
+  private:
+    veml6030_sorted_window window;
+};
+
+// Hampel outlier rejection. A value further than threshold scaled median
+// absolute deviations from the median of the last window_size values is marked
+// invalid. Deviations below min_deviation are never rejected, so a perfectly
+// steady signal doesn't make every small change an outlier. Rejected values
+// still enter the window, so a real step is accepted once it fills half of it.
+class veml6030_outlier_filter : public veml6030_filter_stage {
+  public:
+    veml6030_outlier_filter(size_t window_size, double threshold = 3.0, double min_deviation = 1.0);
+
+    void process(veml6030_filter_point *points, size_t point_count);
+    void reset();
+
+    // Number of values rejected since construction.
+    unsigned long rejected_count() const;
+
+  private:
+    veml6030_sorted_window window;
+    double threshold;
+    double min_deviation;
+    unsigned long rejected;
+};
+
+// One dimensional Kalman filter for a slowly wandering level. The light level
+// is modelled as a random walk whose variance grows by process_variance per
+// second, measured with measurement_variance of noise. The gain adapts to the
+// time between samples, so it copes with missed conversions.
+class veml6030_kalman_filter : public veml6030_filter_stage {
+  public:
+    veml6030_kalman_filter(double process_variance, double measurement_variance);
+
+    void process(veml6030_filter_point *points, size_t point_count);
+    void reset();
+
+    // This function returns the variance of the current estimate.
+    double get_estimate_variance() const;
+
+  private:
+    double process_variance;
+    double measurement_variance;
+    bool primed;
+    int64_t last_timestamp_ns;
+    double estimate;
+    double estimate_variance;
+};
+
+// A chain of stages run in order over each batch. The stages aren't owned and
+// must outlive the pipeline.
+class veml6030_filter_pipeline {
+  public:
+    veml6030_filter_pipeline();
+
+    // This function appends a stage to the chain.
+    void add_stage(veml6030_filter_stage *stage);
+
+    // This function runs every stage over point_count points in place.
+    void process(veml6030_filter_point *points, size_t point_count);
+
+    void reset();
+
+  private:
+    std::vector<veml6030_filter_stage *> stages;
+};
+#endif
@@ -0,0 +1,219 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "veml6030_filter.h"
+#include "veml6030_test.h"
+
+static const int64_t ms = 1000000;
+
+// This function fills points with values spaced spacing_ns apart, all valid.
+static std::vector<veml6030_filter_point> make_points(const std::vector<double> &values, int64_t spacing_ns) {
+    std::vector<veml6030_filter_point> points(values.size());
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        points[i].timestamp_ns = (int64_t)(i + 1) * spacing_ns;
+        points[i].value = values[i];
+        points[i].valid = true;
+    }
+    return points;
+}
+
+// This function returns true if a and b are within tolerance of each other.
+static bool near(double a, double b, double tolerance = 1e-9) {
+    return fabs(a - b) <= tolerance;
+}
+
+// The window's median and MAD match a brute force sort of the last values, both
+// while it fills and after it starts retiring values.
+static void test_sorted_window() {
+    for (size_t window_size = 7; window_size <= 8; ++window_size) {
+        veml6030_sorted_window window(window_size);
+        std::vector<double> values;
+
+        srand(1);
+        for (int i = 0; i < 500; ++i) {
+            double value = rand() % 50;
+
+            values.push_back(value);
+            window.push(value);
+
+            size_t first = (values.size() > window_size) ? (values.size() - window_size) : 0;
+            std::vector<double> recent(values.begin() + first, values.end());
+            std::sort(recent.begin(), recent.end());
+            size_t middle = recent.size() / 2;
+            double median = (recent.size() & 1) ? recent[middle] : ((recent[middle - 1] + recent[middle]) / 2);
+            std::vector<double> deviations;
+            for (size_t j = 0; j < recent.size(); ++j) {
+                deviations.push_back(fabs(recent[j] - median));
+            }
+            std::sort(deviations.begin(), deviations.end());
+
+            VEML6030_CHECK(window.size() == recent.size());
+            VEML6030_CHECK(window.median() == median);
+            VEML6030_CHECK(window.median_absolute_deviation() == deviations[deviations.size() / 2]);
+        }
+        window.clear();
+        VEML6030_CHECK(window.size() == 0);
+    }
+}
+
+// A step moves the average by 1 - exp(-dt / tau), however the time is split
+// between samples, and invalid points are left alone.
+static void test_ema() {
+    veml6030_ema_filter filter(100 * ms);
+    std::vector<veml6030_filter_point> points = make_points({0, 100, 100, 100}, 100 * ms);
+
+    points[2].valid = false;
+    points[2].timestamp_ns = points[1].timestamp_ns + (50 * ms);
+    points[3].timestamp_ns = points[1].timestamp_ns + (100 * ms);
+    filter.process(&points[0], points.size());
+    VEML6030_CHECK(points[0].value == 0);
+    VEML6030_CHECK(near(points[1].value, 100 * (1 - exp(-1))));
+    VEML6030_CHECK(points[2].value == 100);
+    VEML6030_CHECK(near(points[3].value, 100 * (1 - exp(-2))));
+
+    /* Two half time constant steps make one whole one. */
+    veml6030_ema_filter split_filter(100 * ms);
+    std::vector<veml6030_filter_point> split = make_points({0, 100, 100}, 50 * ms);
+    split_filter.process(&split[0], 1);
+    split_filter.process(&split[1], 2);
+    VEML6030_CHECK(near(split[2].value, 100 * (1 - exp(-1))));
+
+    filter.reset();
+    points = make_points({42}, ms);
+    filter.process(&points[0], 1);
+    VEML6030_CHECK(points[0].value == 42);
+}
+
+// An isolated spike disappears while a step comes through intact, half a
+// window late.
+static void test_median() {
+    veml6030_median_filter filter(5);
+    std::vector<veml6030_filter_point> points = make_points({10, 10, 10, 1000, 10, 10, 50, 50, 50, 50}, ms);
+
+    filter.process(&points[0], points.size());
+    VEML6030_CHECK(points[3].value == 10);
+    VEML6030_CHECK(points[4].value == 10);
+    VEML6030_CHECK(points[6].value == 10);
+    VEML6030_CHECK(points[8].value == 50);
+    VEML6030_CHECK(points[9].value == 50);
+
+    filter.reset();
+    points = make_points({7, 9}, ms);
+    filter.process(&points[0], points.size());
+    VEML6030_CHECK((points[0].value == 7) && (points[1].value == 8));
+}
+
+// Spikes are marked invalid without changing their values, small changes on a
+// steady signal are kept, and a real step is accepted once it fills half the
+// window.
+static void test_outlier() {
+    veml6030_outlier_filter filter(9);
+    std::vector<double> values;
+
+    for (int i = 0; i < 20; ++i) {
+        values.push_back(100 + (i & 1));
+    }
+    values.push_back(100.5);
+    values.push_back(500);
+    values.push_back(101);
+    for (int i = 0; i < 10; ++i) {
+        values.push_back(400);
+    }
+    std::vector<veml6030_filter_point> points = make_points(values, ms);
+
+    filter.process(&points[0], points.size());
+    for (int i = 0; i < 21; ++i) {
+        VEML6030_CHECK(points[i].valid);
+    }
+    VEML6030_CHECK(!points[21].valid && (points[21].value == 500));
+    VEML6030_CHECK(points[22].valid);
+
+    int step_rejected = 0;
+    for (int i = 23; i < 33; ++i) {
+        if (!points[i].valid) {
+            ++step_rejected;
+        }
+    }
+    VEML6030_CHECK((step_rejected > 0) && (step_rejected <= 5));
+    VEML6030_CHECK(points[32].valid);
+    VEML6030_CHECK(filter.rejected_count() == (unsigned long)(1 + step_rejected));
+
+    /* With no spread at all, min_deviation decides. */
+    veml6030_outlier_filter steady_filter(9, 3.0, 1.0);
+    points = make_points({100, 100, 100, 100, 100, 100.5, 102}, ms);
+    steady_filter.process(&points[0], points.size());
+    VEML6030_CHECK(points[5].valid);
+    VEML6030_CHECK(!points[6].valid);
+}
+
+// The estimate follows the closed form for the first update, the variance
+// shrinks on a steady signal, and a longer gap trusts the new value more.
+static void test_kalman() {
+    const double process_variance = 4;
+    const double measurement_variance = 16;
+    veml6030_kalman_filter filter(process_variance, measurement_variance);
+    std::vector<veml6030_filter_point> points = make_points({100, 120}, 1000 * ms);
+
+    filter.process(&points[0], points.size());
+    double predicted = measurement_variance + process_variance;
+    double gain = predicted / (predicted + measurement_variance);
+    VEML6030_CHECK(points[0].value == 100);
+    VEML6030_CHECK(near(points[1].value, 100 + (gain * 20)));
+    VEML6030_CHECK(near(filter.get_estimate_variance(), predicted * (1 - gain)));
+
+    double last_variance = filter.get_estimate_variance();
+    for (int i = 0; i < 20; ++i) {
+        veml6030_filter_point point = {points[1].timestamp_ns + ((i + 1) * 10 * ms), 120, true};
+
+        filter.process(&point, 1);
+        VEML6030_CHECK(filter.get_estimate_variance() < last_variance);
+        last_variance = filter.get_estimate_variance();
+    }
+
+    veml6030_kalman_filter quick(process_variance, measurement_variance);
+    veml6030_kalman_filter slow(process_variance, measurement_variance);
+    std::vector<veml6030_filter_point> quick_points = make_points({100, 200}, 10 * ms);
+    std::vector<veml6030_filter_point> slow_points = make_points({100, 200}, 10000 * ms);
+    quick.process(&quick_points[0], 2);
+    slow.process(&slow_points[0], 2);
+    VEML6030_CHECK(slow_points[1].value > quick_points[1].value);
+}
+
+// In a pipeline, a point the outlier stage rejects passes the later stages
+// untouched, and they never see its value.
+static void test_pipeline() {
+    veml6030_outlier_filter outliers(9);
+    veml6030_median_filter median(3);
+    veml6030_filter_pipeline pipeline;
+    std::vector<double> values;
+
+    for (int i = 0; i < 12; ++i) {
+        values.push_back(100 + (i % 3));
+    }
+    values.push_back(900);
+    values.push_back(101);
+    std::vector<veml6030_filter_point> points = make_points(values, ms);
+
+    pipeline.add_stage(&outliers);
+    pipeline.add_stage(&median);
+    pipeline.process(&points[0], points.size());
+    VEML6030_CHECK(!points[12].valid && (points[12].value == 900));
+    VEML6030_CHECK(points[13].valid && (points[13].value == 101));
+
+    pipeline.reset();
+    VEML6030_CHECK(outliers.rejected_count() == 1);
+}
+
+int main() {
+    test_sorted_window();
+    test_ema();
+    test_median();
+    test_outlier();
+    test_kalman();
+    test_pipeline();
+    return veml6030_test_result();
+}
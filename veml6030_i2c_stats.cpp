@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "veml6030_i2c_stats.h"
+
+veml6030_i2c_stats::veml6030_i2c_stats() {
+    reset();
+}
+
+#ifdef VEML6030_I2C_STATS
+// This function counts a transaction and files its latency in the power of two
+// microsecond bucket it falls in.
+void veml6030_i2c_stats::record_latency(int64_t latency_ns) {
+    uint64_t latency_us = (latency_ns > 0) ? (latency_ns / 1000) : 0;
+    uint64_t previous_max = latency_max_ns.load(std::memory_order_relaxed);
+    int bucket = 0;
+
+    while ((latency_us > 1) && (bucket < (veml6030_i2c_stats_latency_buckets - 1))) {
+        latency_us >>= 1;
+        ++bucket;
+    }
+    transactions.fetch_add(1, std::memory_order_relaxed);
+    latency_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    latency_total_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+    while (((uint64_t)latency_ns > previous_max) &&
+           !latency_max_ns.compare_exchange_weak(previous_max, latency_ns, std::memory_order_relaxed)) {
+    }
+}
+
+// This function counts a failed transaction by the kind of failure.
+void veml6030_i2c_stats::record_error(int status) {
+    switch (-status) {
+    case ENXIO:
+    case EREMOTEIO:
+        naks.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case ETIMEDOUT:
+        timeouts.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case EIO:
+        io_errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case EAGAIN:
+        arbitration_lost.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        other_errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+}
+#endif
+
+// This function copies the counters. Each counter is read atomically, but the
+// set isn't read as a whole, so counters updated during the copy may be one
+// transaction apart.
+void veml6030_i2c_stats::snapshot(veml6030_i2c_stats_snapshot &stats_snapshot) const {
+    memset(&stats_snapshot, 0, sizeof(stats_snapshot));
+#ifdef VEML6030_I2C_STATS
+    for (int reg = 0; reg < veml6030_i2c_stats_registers; ++reg) {
+        stats_snapshot.register_reads[reg] = register_reads[reg].load(std::memory_order_relaxed);
+        stats_snapshot.register_writes[reg] = register_writes[reg].load(std::memory_order_relaxed);
+    }
+    stats_snapshot.transactions = transactions.load(std::memory_order_relaxed);
+    for (int bucket = 0; bucket < veml6030_i2c_stats_latency_buckets; ++bucket) {
+        stats_snapshot.latency_histogram[bucket] = latency_histogram[bucket].load(std::memory_order_relaxed);
+    }
+    stats_snapshot.latency_total_ns = latency_total_ns.load(std::memory_order_relaxed);
+    stats_snapshot.latency_max_ns = latency_max_ns.load(std::memory_order_relaxed);
+    stats_snapshot.naks = naks.load(std::memory_order_relaxed);
+    stats_snapshot.timeouts = timeouts.load(std::memory_order_relaxed);
+    stats_snapshot.io_errors = io_errors.load(std::memory_order_relaxed);
+    stats_snapshot.arbitration_lost = arbitration_lost.load(std::memory_order_relaxed);
+    stats_snapshot.other_errors = other_errors.load(std::memory_order_relaxed);
+    stats_snapshot.retries = retries.load(std::memory_order_relaxed);
+#endif
+}
+
+void veml6030_i2c_stats::reset() {
+#ifdef VEML6030_I2C_STATS
+    for (int reg = 0; reg < veml6030_i2c_stats_registers; ++reg) {
+        register_reads[reg].store(0, std::memory_order_relaxed);
+        register_writes[reg].store(0, std::memory_order_relaxed);
+    }
+    transactions.store(0, std::memory_order_relaxed);
+    for (int bucket = 0; bucket < veml6030_i2c_stats_latency_buckets; ++bucket) {
+        latency_histogram[bucket].store(0, std::memory_order_relaxed);
+    }
+    latency_total_ns.store(0, std::memory_order_relaxed);
+    latency_max_ns.store(0, std::memory_order_relaxed);
+    naks.store(0, std::memory_order_relaxed);
+    timeouts.store(0, std::memory_order_relaxed);
+    io_errors.store(0, std::memory_order_relaxed);
+    arbitration_lost.store(0, std::memory_order_relaxed);
+    other_errors.store(0, std::memory_order_relaxed);
+    retries.store(0, std::memory_order_relaxed);
+#endif
+}
+
+// This function returns the upper edge of the histogram bucket holding the
+// transaction at fraction of the way through the latency distribution.
+uint64_t veml6030_i2c_stats_snapshot::latency_percentile_ns(double fraction) const {
+    uint64_t target;
+    uint64_t seen = 0;
+
+    if (transactions == 0) {
+        return 0;
+    }
+    target = (uint64_t)(fraction * transactions);
+    if (target >= transactions) {
+        target = transactions - 1;
+    }
+    for (int bucket = 0; bucket < veml6030_i2c_stats_latency_buckets; ++bucket) {
+        seen += latency_histogram[bucket];
+        if (seen > target) {
+            return (2ULL << bucket) * 1000;
+        }
+    }
+    return latency_max_ns;
+}
+
+void veml6030_i2c_stats_snapshot::dump(FILE *output_file) const {
+    static const char *register_names[veml6030_i2c_stats_registers] = {
+        "ALS_CONF", "ALS_WH", "ALS_WL", "POWER_SAVING", "ALS", "WHITE", "ALS_INT", "other"};
+
+#ifndef VEML6030_I2C_STATS
+    fprintf(output_file, "i2c statistics were disabled at build time.\n");
+    return;
+#endif
+    fprintf(output_file, "i2c transactions: %llu\n", (unsigned long long)transactions);
+    fprintf(output_file, "  register       reads     writes\n");
+    for (int reg = 0; reg < veml6030_i2c_stats_registers; ++reg) {
+        if ((register_reads[reg] != 0) || (register_writes[reg] != 0)) {
+            fprintf(output_file, "  %-12s %8llu %10llu\n", register_names[reg],
+                    (unsigned long long)register_reads[reg], (unsigned long long)register_writes[reg]);
+        }
+    }
+    if (transactions > 0) {
+        fprintf(output_file, "latency: mean %llu ns, p50 < %llu ns, p99 < %llu ns, max %llu ns\n",
+                (unsigned long long)(latency_total_ns / transactions),
+                (unsigned long long)latency_percentile_ns(0.50), (unsigned long long)latency_percentile_ns(0.99),
+                (unsigned long long)latency_max_ns);
+        for (int bucket = 0; bucket < veml6030_i2c_stats_latency_buckets; ++bucket) {
+            if (latency_histogram[bucket] != 0) {
+                fprintf(output_file, "  < %8llu us %10llu\n", (unsigned long long)(2ULL << bucket),
+                        (unsigned long long)latency_histogram[bucket]);
+            }
+        }
+    }
+    fprintf(output_file, "errors: nak %llu, timeout %llu, eio %llu, arbitration lost %llu, other %llu, retries %llu\n",
+            (unsigned long long)naks, (unsigned long long)timeouts, (unsigned long long)io_errors,
+            (unsigned long long)arbitration_lost, (unsigned long long)other_errors, (unsigned long long)retries);
+}
@@ -0,0 +1,124 @@
+#ifndef _VEML6030_I2C_STATS_H_
+#define _VEML6030_I2C_STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <atomic>
+#include "veml6030_clock.h"
+
+// Bus transaction counters kept by every transport: register reads and writes
+// by register, a latency histogram of the ioctls, and errors by kind. Recording
+// is a few relaxed atomic increments, so any thread may read a snapshot while
+// the sampling thread records.
+//
+// Building without VEML6030_I2C_STATS (the CMake option of the same name)
+// removes the counters and the clock reads; the recording functions are then
+// empty inlines and snapshots are all zero.
+
+static const int veml6030_i2c_stats_registers = 8;       // REG0x00 - REG0x06, then "other"
+static const int veml6030_i2c_stats_latency_buckets = 24; // Bucket i counts [2^i, 2^(i+1)) us, bucket 0 < 2 us
+
+// A plain copy of the counters at one moment.
+struct veml6030_i2c_stats_snapshot {
+    uint64_t register_reads[veml6030_i2c_stats_registers];
+    uint64_t register_writes[veml6030_i2c_stats_registers];
+    uint64_t transactions;
+    uint64_t latency_histogram[veml6030_i2c_stats_latency_buckets];
+    uint64_t latency_total_ns;
+    uint64_t latency_max_ns;
+    uint64_t naks;             // ENXIO or EREMOTEIO: no acknowledge from the sensor
+    uint64_t timeouts;         // ETIMEDOUT
+    uint64_t io_errors;        // EIO
+    uint64_t arbitration_lost; // EAGAIN
+    uint64_t other_errors;
+    uint64_t retries;
+
+    // This function returns an upper bound on the latency below which fraction
+    // (0 to 1) of the transactions completed, from the histogram.
+    uint64_t latency_percentile_ns(double fraction) const;
+
+    // This function writes the counters as text to output_file.
+    void dump(FILE *output_file) const;
+};
+
+class veml6030_i2c_stats {
+  public:
+    veml6030_i2c_stats();
+
+    // This function returns a start time to pass to record_transaction().
+    int64_t transaction_start() const {
+#ifdef VEML6030_I2C_STATS
+        return veml6030_monotonic_ns();
+#else
+        return 0;
+#endif
+    }
+
+    // These functions count a read or write of reg.
+    void record_read(uint8_t reg) {
+#ifdef VEML6030_I2C_STATS
+        register_reads[register_slot(reg)].fetch_add(1, std::memory_order_relaxed);
+#else
+        (void)reg;
+#endif
+    }
+    void record_write(uint8_t reg) {
+#ifdef VEML6030_I2C_STATS
+        register_writes[register_slot(reg)].fetch_add(1, std::memory_order_relaxed);
+#else
+        (void)reg;
+#endif
+    }
+
+    // This function counts one bus transaction that began at start_ns and ended
+    // with status (0 or a negative errno value).
+    void record_transaction(int64_t start_ns, int status) {
+#ifdef VEML6030_I2C_STATS
+        record_latency(veml6030_monotonic_ns() - start_ns);
+        if (status < 0) {
+            record_error(status);
+        }
+#else
+        (void)start_ns;
+        (void)status;
+#endif
+    }
+
+    // This function counts a transaction that is being retried.
+    void record_retry() {
+#ifdef VEML6030_I2C_STATS
+        retries.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    void snapshot(veml6030_i2c_stats_snapshot &stats_snapshot) const;
+    void reset();
+
+  private:
+#ifdef VEML6030_I2C_STATS
+    std::atomic<uint64_t> register_reads[veml6030_i2c_stats_registers];
+    std::atomic<uint64_t> register_writes[veml6030_i2c_stats_registers];
+    std::atomic<uint64_t> transactions;
+    std::atomic<uint64_t> latency_histogram[veml6030_i2c_stats_latency_buckets];
+    std::atomic<uint64_t> latency_total_ns;
+    std::atomic<uint64_t> latency_max_ns;
+    std::atomic<uint64_t> naks;
+    std::atomic<uint64_t> timeouts;
+    std::atomic<uint64_t> io_errors;
+    std::atomic<uint64_t> arbitration_lost;
+    std::atomic<uint64_t> other_errors;
+    std::atomic<uint64_t> retries;
+
+    static int register_slot(uint8_t reg) {
+        return (reg < (veml6030_i2c_stats_registers - 1)) ? reg : (veml6030_i2c_stats_registers - 1);
+    }
+
+    void record_latency(int64_t latency_ns);
+    void record_error(int status);
+#endif
+
+    veml6030_i2c_stats(const veml6030_i2c_stats &) = delete;
+    veml6030_i2c_stats &operator=(const veml6030_i2c_stats &) = delete;
+};
+#endif
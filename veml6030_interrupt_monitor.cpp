@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "veml6030_interrupt_monitor.h"
+
+veml6030_interrupt_monitor::veml6030_interrupt_monitor(SparkFun_Ambient_Light *sensor)
+    : sensor(sensor),
+      event_fd(-1),
+      owns_event_fd(false),
+      gpio_line(false),
+      status_pending(false) {
+}
+
+veml6030_interrupt_monitor::~veml6030_interrupt_monitor() {
+    close_event_fd();
+}
+
+void veml6030_interrupt_monitor::close_event_fd() {
+    if (owns_event_fd && (event_fd >= 0)) {
+        close(event_fd);
+    }
+    event_fd = -1;
+    owns_event_fd = false;
+    gpio_line = false;
+    status_pending = false;
+}
+
+// This function reads the level of the GPIO line. The line isn't requested active
+// low, so a value of 0 is the sensor pulling INT low.
+bool veml6030_interrupt_monitor::line_asserted() {
+    struct gpio_v2_line_values line_values;
+
+    if (!gpio_line) {
+        return false;
+    }
+    memset(&line_values, 0, sizeof(line_values));
+    line_values.mask = 1;
+    if (ioctl(event_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &line_values) < 0) {
+        perror("ioctl(GPIO_V2_LINE_GET_VALUES_IOCTL) in veml6030_interrupt_monitor");
+        return false;
+    }
+    return ((line_values.bits & 1) == 0);
+}
+
+bool veml6030_interrupt_monitor::interrupt_pending() {
+    return status_pending || line_asserted();
+}
+
+// This function requests line_offset of gpiochip_name as an input with falling
+// edge events. The chip fd is only needed to make the request; the events come
+// from the line fd it returns, which is made non-blocking for handle_event(). If
+// INT is already low, it was latched before there was anyone to see the edge, so
+// the status register is read to release it.
+bool veml6030_interrupt_monitor::open_gpio_line(const char *gpiochip_name, unsigned int line_offset) {
+    struct gpio_v2_line_request line_request;
+    int chip_fd;
+
+    close_event_fd();
+    chip_fd = open(gpiochip_name, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) {
+        perror("open() of gpio chip in veml6030_interrupt_monitor");
+        return false;
+    }
+    memset(&line_request, 0, sizeof(line_request));
+    line_request.offsets[0] = line_offset;
+    line_request.num_lines = 1;
+    strncpy(line_request.consumer, "veml6030_int", sizeof(line_request.consumer) - 1);
+    line_request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &line_request) < 0) {
+        perror("ioctl(GPIO_V2_GET_LINE_IOCTL) in veml6030_interrupt_monitor");
+        close(chip_fd);
+        return false;
+    }
+    close(chip_fd);
+    event_fd = line_request.fd;
+    owns_event_fd = true;
+    if (fcntl(event_fd, F_SETFL, fcntl(event_fd, F_GETFL) | O_NONBLOCK) < 0) {
+        perror("fcntl(O_NONBLOCK) of gpio line in veml6030_interrupt_monitor");
+        close_event_fd();
+        return false;
+    }
+    gpio_line = true;
+    if (line_asserted()) {
+        sensor->read_interrupt();
+    }
+    return true;
+}
+
+void veml6030_interrupt_monitor::set_event_fd(int event_fd) {
+    close_event_fd();
+    this->event_fd = event_fd;
+    owns_event_fd = false;
+}
+
+int veml6030_interrupt_monitor::get_fd() const {
+    return event_fd;
+}
+
+void veml6030_interrupt_monitor::set_callback(interrupt_callback callback) {
+    this->callback = callback;
+}
+
+// This function sets the sensor's thresholds and enables its interrupt. A read of
+// the status register clears any interrupt already latched with old thresholds.
+void veml6030_interrupt_monitor::arm(uint32_t low_lux, uint32_t high_lux) {
+    sensor->set_interrupt_low_threshold(low_lux);
+    sensor->set_interrupt_high_threshold(high_lux);
+    sensor->enable_interrupt();
+    sensor->read_interrupt();
+}
+
+void veml6030_interrupt_monitor::disarm() {
+    sensor->disable_interrupt();
+}
+
+// This function handles a pending event on the event source. All queued line
+// events are drained first, since one sensor read answers all of them. The fd
+// is polled before each read, and the GPIO line fd is non-blocking as well, so
+// with nothing pending this returns at once instead of waiting for an event.
+// Without an event the sensor is still read if INT is stuck low.
+bool veml6030_interrupt_monitor::handle_event() {
+    struct gpio_v2_line_event line_events[16];
+    struct pollfd pending_events;
+    ssize_t read_size;
+    bool had_event = false;
+
+    pending_events.fd = event_fd;
+    pending_events.events = POLLIN;
+    for (;;) {
+        if (poll(&pending_events, 1, 0) <= 0) {
+            break;
+        }
+        read_size = read(event_fd, line_events, sizeof(line_events));
+        if (read_size > 0) {
+            had_event = true;
+        } else if ((read_size < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            /* EAGAIN: another reader took the event first. */
+            break;
+        }
+    }
+    if (!had_event && !interrupt_pending()) {
+        return false;
+    }
+    return read_interrupt_sample();
+}
+
+// This function reads the sensor for an interrupt. Reading the status register
+// is what releases INT, so a failed sample read is followed by a plain status
+// read; if that fails as well the interrupt stays pending for the next call.
+// Another interrupt can latch between the read and the level check, so the
+// sensor is read again while the line is still low.
+bool veml6030_interrupt_monitor::read_interrupt_sample() {
+    veml6030_sample sample;
+
+    for (int drain_reads = 0; drain_reads < max_drain_reads; drain_reads++) {
+        if (!sensor->read_sample(sample, true)) {
+            status_pending = !sensor->read_register_checked(INTERRUPT_STATUS_REG).ok();
+            return false;
+        }
+        status_pending = false;
+        if (callback && (sample.interrupt_status != NO_INT)) {
+            callback(sample);
+        }
+        if (!line_asserted()) {
+            break;
+        }
+    }
+    return true;
+}
+
+// This function waits up to timeout_ms for an interrupt and handles it. An
+// interrupt that is already pending is handled without waiting, since no edge
+// will come for it.
+int veml6030_interrupt_monitor::wait(int timeout_ms) {
+    struct pollfd event_poll;
+    int poll_result;
+
+    if (event_fd < 0) {
+        return -1;
+    }
+    if (interrupt_pending()) {
+        return handle_event() ? 1 : -1;
+    }
+    event_poll.fd = event_fd;
+    event_poll.events = POLLIN;
+    do {
+        poll_result = poll(&event_poll, 1, timeout_ms);
+    } while ((poll_result < 0) && (errno == EINTR));
+    if (poll_result < 0) {
+        perror("poll() in veml6030_interrupt_monitor");
+        return -1;
+    }
+    if (poll_result == 0) {
+        return 0;
+    }
+    return handle_event() ? 1 : -1;
+}
@@ -0,0 +1,96 @@
+#ifndef _VEML6030_INTERRUPT_MONITOR_H_
+#define _VEML6030_INTERRUPT_MONITOR_H_
+
+#include <stdint.h>
+#include <functional>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+
+// Event driven use of the sensor's INT pin. The sensor pulls INT low when a
+// reading crosses the high or low threshold (after the persistence protect
+// count). The monitor waits for that edge on a GPIO line through the Linux GPIO
+// character device, and only then reads the sensor: the interrupt status and
+// both light channels in one transaction. Between light transitions there is no
+// bus traffic and the waiting thread uses no CPU.
+//
+// INT stays low until the interrupt status register is read, and only the
+// falling edge is an event, so an interrupt that is never read would stop all
+// further events. The monitor therefore reads the line level as well: when the
+// line is opened, and after each interrupt it has read, it reads the sensor again
+// while INT is still low. If reading the sample fails, it still reads the status
+// register to release INT, and if that fails too, the next handle_event() or
+// wait() reads the sensor without waiting for an edge.
+//
+// For testing, any fd that becomes readable (an eventfd or a pipe) can stand in
+// for the GPIO line with set_event_fd(). Such an fd has no level to read.
+class veml6030_interrupt_monitor {
+  public:
+    // Called for each interrupt with the sample read when it fired. The
+    // interrupt status is in sample.interrupt_status (INT_HIGH or INT_LOW).
+    typedef std::function<void(const veml6030_sample &sample)> interrupt_callback;
+
+    veml6030_interrupt_monitor(SparkFun_Ambient_Light *sensor);
+    ~veml6030_interrupt_monitor();
+
+    // This function requests line_offset of gpiochip_name (e.g. "/dev/gpiochip0")
+    // as an input with falling edge events, for the sensor's active low INT pin.
+    // An interrupt already latched when the line is opened is cleared. It returns
+    // false if the line couldn't be requested.
+    bool open_gpio_line(const char *gpiochip_name, unsigned int line_offset);
+
+    // This function uses event_fd as the event source instead of a GPIO line. The
+    // monitor doesn't take ownership of it. Whatever is written to it is
+    // discarded when the event is handled.
+    void set_event_fd(int event_fd);
+
+    // This function returns the event source fd, for adding to a poll or epoll set.
+    int get_fd() const;
+
+    void set_callback(interrupt_callback callback);
+
+    // This function sets the sensor's thresholds and enables its interrupt.
+    void arm(uint32_t low_lux, uint32_t high_lux);
+
+    // This function disables the sensor's interrupt.
+    void disarm();
+
+    // This function handles a pending event on the event source: it clears the
+    // event, reads the sensor and calls the callback. It also reads the sensor
+    // without an event if INT is still low or an earlier read left it latched. It
+    // returns false if there was nothing to handle or the read failed.
+    bool handle_event();
+
+    // This function waits up to timeout_ms (-1 waits forever) for an interrupt
+    // and handles it. It returns 1 if an interrupt was handled, 0 on timeout and
+    // -1 on error.
+    int wait(int timeout_ms);
+
+  private:
+    SparkFun_Ambient_Light *sensor;
+    interrupt_callback callback;
+    int event_fd;
+    bool owns_event_fd;
+    bool gpio_line;
+    bool status_pending;
+
+    // Most times the sensor is read again for one event while INT stays low.
+    static const int max_drain_reads = 4;
+
+    // This function closes the event source if the monitor owns it.
+    void close_event_fd();
+
+    // This function returns true if the GPIO line is low, i.e. the sensor is
+    // holding INT asserted. It returns false for other event sources.
+    bool line_asserted();
+
+    // This function returns true if the sensor should be read without an event.
+    bool interrupt_pending();
+
+    // This function reads the interrupt status and both channels, calls the
+    // callback, and reads again while INT stays low. It returns false if the
+    // read failed.
+    bool read_interrupt_sample();
+
+    veml6030_interrupt_monitor(const veml6030_interrupt_monitor &) = delete;
+    veml6030_interrupt_monitor &operator=(const veml6030_interrupt_monitor &) = delete;
+};
+#endif
@@ -0,0 +1,87 @@
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_interrupt_monitor.h"
+#include "veml6030_test.h"
+
+static const uint16_t int_high_status = INT_HIGH << INTERRUPT_STATUS_POS;
+
+// This function latches a high threshold interrupt in the simulated sensor and
+// signals the event fd, the way INT falling would.
+static void raise_interrupt(fake_veml6030_transport &transport, int event_fd) {
+    uint64_t event_count = 1;
+
+    transport.set_register(0x48, INTERRUPT_STATUS_REG, int_high_status);
+    VEML6030_CHECK(write(event_fd, &event_count, sizeof(event_count)) == sizeof(event_count));
+}
+
+// An event reads the sensor once and reports the interrupt; without one nothing
+// is read and nothing blocks.
+static void test_events() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    veml6030_interrupt_monitor monitor(&light);
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int interrupts = 0;
+
+    monitor.set_event_fd(event_fd);
+    monitor.set_callback([&](const veml6030_sample &sample) {
+        VEML6030_CHECK(sample.interrupt_status == INT_HIGH);
+        interrupts++;
+    });
+    monitor.arm(10, 1000);
+
+    transport.reset_counts();
+    VEML6030_CHECK(!monitor.handle_event());
+    VEML6030_CHECK(monitor.wait(0) == 0);
+    VEML6030_CHECK(transport.read_count() == 0);
+
+    raise_interrupt(transport, event_fd);
+    VEML6030_CHECK(monitor.wait(1000) == 1);
+    VEML6030_CHECK(interrupts == 1);
+    VEML6030_CHECK(transport.read_count() == 1);
+    VEML6030_CHECK(transport.get_register(0x48, INTERRUPT_STATUS_REG) == 0);
+    VEML6030_CHECK(!monitor.handle_event());
+    close(event_fd);
+}
+
+// A failed sample read still releases INT by reading the status register, and
+// if that fails too the next call reads the sensor without another event.
+static void test_failed_reads() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    veml6030_interrupt_monitor monitor(&light);
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int interrupts = 0;
+
+    monitor.set_event_fd(event_fd);
+    monitor.set_callback([&](const veml6030_sample &) { interrupts++; });
+    monitor.arm(10, 1000);
+
+    raise_interrupt(transport, event_fd);
+    transport.inject_failures(1, -EIO);
+    VEML6030_CHECK(!monitor.handle_event());
+    VEML6030_CHECK(transport.get_register(0x48, INTERRUPT_STATUS_REG) == 0);
+    VEML6030_CHECK(!monitor.handle_event());
+    VEML6030_CHECK(interrupts == 0);
+
+    raise_interrupt(transport, event_fd);
+    transport.inject_failures(2, -EIO);
+    VEML6030_CHECK(!monitor.handle_event());
+    VEML6030_CHECK(transport.get_register(0x48, INTERRUPT_STATUS_REG) == int_high_status);
+    VEML6030_CHECK(monitor.wait(-1) == 1);
+    VEML6030_CHECK(interrupts == 1);
+    VEML6030_CHECK(transport.get_register(0x48, INTERRUPT_STATUS_REG) == 0);
+    VEML6030_CHECK(monitor.wait(0) == 0);
+    close(event_fd);
+}
+
+int main() {
+    test_events();
+    test_failed_reads();
+    return veml6030_test_result();
+}
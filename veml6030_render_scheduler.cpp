@@ -0,0 +1,53 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "veml6030_render_scheduler.h"
+
+veml6030_render_scheduler::veml6030_render_scheduler(unsigned int max_frames_per_second)
+    : last_frame_ns(0),
+      pending_samples(0),
+      frames(0),
+      samples(0) {
+    set_max_frames_per_second(max_frames_per_second);
+}
+
+void veml6030_render_scheduler::set_max_frames_per_second(unsigned int max_frames_per_second) {
+    if (max_frames_per_second == 0) {
+        max_frames_per_second = 1;
+    }
+    this->max_frames_per_second = max_frames_per_second;
+    frame_interval_ns = 1000000000LL / max_frames_per_second;
+}
+
+unsigned int veml6030_render_scheduler::get_max_frames_per_second() const {
+    return max_frames_per_second;
+}
+
+unsigned int veml6030_render_scheduler::get_frame_interval_ms() const {
+    unsigned int frame_interval_ms = frame_interval_ns / 1000000;
+
+    return (frame_interval_ms > 0) ? frame_interval_ms : 1;
+}
+
+void veml6030_render_scheduler::samples_arrived(size_t sample_count) {
+    pending_samples += sample_count;
+}
+
+bool veml6030_render_scheduler::frame_due(int64_t now_ns) const {
+    return ((pending_samples > 0) && ((now_ns - last_frame_ns) >= frame_interval_ns));
+}
+
+void veml6030_render_scheduler::frame_rendered(int64_t now_ns) {
+    last_frame_ns = now_ns;
+    samples += pending_samples;
+    pending_samples = 0;
+    ++frames;
+}
+
+unsigned long veml6030_render_scheduler::frames_rendered() const {
+    return frames;
+}
+
+unsigned long veml6030_render_scheduler::samples_rendered() const {
+    return samples;
+}
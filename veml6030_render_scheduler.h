@@ -0,0 +1,48 @@
+#ifndef _VEML6030_RENDER_SCHEDULER_H_
+#define _VEML6030_RENDER_SCHEDULER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decides when accumulated samples get drawn. Samples can arrive at any rate
+// from any number of sensors; they are only committed to the display when a
+// frame is due, at most max_frames_per_second times a second and only if
+// something new arrived. Drawing cost then follows the frame rate, not the
+// sample rate.
+class veml6030_render_scheduler {
+  public:
+    static const unsigned int default_frames_per_second = 30;
+
+    veml6030_render_scheduler(unsigned int max_frames_per_second = default_frames_per_second);
+
+    // This function changes the frame rate cap. 0 is treated as 1.
+    void set_max_frames_per_second(unsigned int max_frames_per_second);
+    unsigned int get_max_frames_per_second() const;
+
+    // This function returns the minimum time between frames in ms, which is how
+    // often the caller should check for a due frame.
+    unsigned int get_frame_interval_ms() const;
+
+    // This function records that sample_count new samples are waiting to be drawn.
+    void samples_arrived(size_t sample_count);
+
+    // This function returns true if samples are waiting and the last frame was at
+    // least one frame interval before now_ns (CLOCK_MONOTONIC).
+    bool frame_due(int64_t now_ns) const;
+
+    // This function records that a frame committing all waiting samples was drawn at now_ns.
+    void frame_rendered(int64_t now_ns);
+
+    // Frames drawn and samples committed by them so far.
+    unsigned long frames_rendered() const;
+    unsigned long samples_rendered() const;
+
+  private:
+    unsigned int max_frames_per_second;
+    int64_t frame_interval_ns;
+    int64_t last_frame_ns;
+    size_t pending_samples;
+    unsigned long frames;
+    unsigned long samples;
+};
+#endif
@@ -0,0 +1,255 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "veml6030_replay.h"
+#include "veml6030_clock.h"
+
+veml6030_replay::veml6030_replay()
+    : reader(),
+      fake_transport(replay_address),
+      sensor(&fake_transport, replay_address),
+      speed(1.0),
+      epoch_ms_offset(0),
+      dropped(0),
+      replayed(0),
+      done(false),
+      segment_epoch_ms_offset(0),
+      segment_offset_ns(0),
+      last_recorded_ns(0),
+      last_timeline_ns(0) {
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        perror("eventfd() in veml6030_replay");
+    }
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        perror("timerfd_create() in veml6030_replay");
+    }
+}
+
+veml6030_replay::~veml6030_replay() {
+    stop();
+    if (stop_fd >= 0) {
+        close(stop_fd);
+    }
+    if (timer_fd >= 0) {
+        close(timer_fd);
+    }
+}
+
+// This function opens a capture file and takes the epoch offset from its first
+// sample, which the timeline is built on. A speed of 0 or less replays as fast as possible.
+bool veml6030_replay::open(const char *file_name, double speed) {
+    veml6030_capture_record record;
+
+    stop();
+    if (!reader.open(file_name)) {
+        return false;
+    }
+    if (!reader.next(record)) {
+        fprintf(stderr, "%s has no samples to replay.\n", file_name);
+        reader.close();
+        return false;
+    }
+    reader.rewind();
+    epoch_ms_offset = record.epoch_ms_offset;
+    this->speed = speed;
+    return true;
+}
+
+int64_t veml6030_replay::get_epoch_ms_offset() const {
+    return epoch_ms_offset;
+}
+
+void veml6030_replay::start() {
+    uint64_t stop_count;
+
+    if (replay_thread.joinable() || (stop_fd < 0) || (timer_fd < 0)) {
+        return;
+    }
+    if (read(stop_fd, &stop_count, sizeof(stop_count)) < 0) {
+        stop_count = 0;
+    }
+    reader.rewind();
+    replayed.store(0, std::memory_order_relaxed);
+    done.store(false, std::memory_order_relaxed);
+    replay_thread = std::thread(&veml6030_replay::run, this);
+}
+
+void veml6030_replay::stop() {
+    uint64_t stop_count = 1;
+
+    if (!replay_thread.joinable()) {
+        return;
+    }
+    if (write(stop_fd, &stop_count, sizeof(stop_count)) < 0) {
+        perror("write() of stop request in veml6030_replay");
+    }
+    replay_thread.join();
+}
+
+size_t veml6030_replay::drain(veml6030_timed_sample *samples, size_t max_count) {
+    return this->samples.pop_batch(samples, max_count);
+}
+
+unsigned long veml6030_replay::dropped_samples() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+unsigned long veml6030_replay::replayed_samples() const {
+    return replayed.load(std::memory_order_relaxed);
+}
+
+bool veml6030_replay::finished() const {
+    return done.load(std::memory_order_acquire);
+}
+
+// This function waits until the CLOCK_MONOTONIC time due_ns or a stop request.
+// It returns false if stop was requested. A due time already past costs no syscall
+// beyond the clock read, so fast replays don't pay for the timer.
+bool veml6030_replay::wait_until(int64_t due_ns) {
+    struct pollfd wait_fds[2];
+    struct itimerspec timer_setting;
+    uint64_t expirations;
+
+    if (due_ns <= veml6030_monotonic_ns()) {
+        return true;
+    }
+    timer_setting.it_interval.tv_sec = 0;
+    timer_setting.it_interval.tv_nsec = 0;
+    timer_setting.it_value.tv_sec = due_ns / 1000000000;
+    timer_setting.it_value.tv_nsec = due_ns % 1000000000;
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer_setting, NULL);
+
+    wait_fds[0].fd = stop_fd;
+    wait_fds[0].events = POLLIN;
+    wait_fds[1].fd = timer_fd;
+    wait_fds[1].events = POLLIN;
+    for (;;) {
+        if (poll(wait_fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll() in veml6030_replay");
+            return false;
+        }
+        if (wait_fds[0].revents & POLLIN) {
+            return false;
+        }
+        if (wait_fds[1].revents & POLLIN) {
+            if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+                expirations = 0;
+            }
+            return true;
+        }
+    }
+}
+
+// Epoch offsets within one session only differ by the rounding of each block's
+// offset to a ms and by clock adjustments; a bigger change means a new session.
+static const int64_t session_change_ms = 1000;
+
+void veml6030_replay::start_timeline(const veml6030_capture_record &record) {
+    segment_epoch_ms_offset = record.epoch_ms_offset;
+    segment_offset_ns = 0;
+    last_recorded_ns = record.timestamp_ns;
+    last_timeline_ns = record.timestamp_ns;
+}
+
+// This function moves record onto the first session's clock. A new session
+// shows up as the monotonic clock going backwards or the epoch offset jumping;
+// its records are then shifted by the difference between its epoch offset and
+// the first session's. The timeline is kept from going backwards in case the
+// wall clock was stepped back between sessions.
+int64_t veml6030_replay::timeline_ns(const veml6030_capture_record &record) {
+    int64_t offset_change_ms = record.epoch_ms_offset - segment_epoch_ms_offset;
+    int64_t record_timeline_ns;
+
+    if ((record.timestamp_ns < last_recorded_ns) || (offset_change_ms > session_change_ms) ||
+        (offset_change_ms < -session_change_ms)) {
+        segment_offset_ns += offset_change_ms * 1000000;
+        segment_epoch_ms_offset = record.epoch_ms_offset;
+    }
+    last_recorded_ns = record.timestamp_ns;
+    record_timeline_ns = record.timestamp_ns + segment_offset_ns;
+    if (record_timeline_ns < last_timeline_ns) {
+        record_timeline_ns = last_timeline_ns;
+    }
+    last_timeline_ns = record_timeline_ns;
+    return record_timeline_ns;
+}
+
+// This function loads a recorded sample into the fake sensor and reads it back
+// through the driver. A configuration change is made behind the driver's back
+// and picked up with validate_shadow_registers(), the way a sensor reconfigured
+// by someone else would be.
+bool veml6030_replay::replay_record(const veml6030_capture_record &record, veml6030_sample &sample) {
+    if ((fake_transport.get_register(replay_address, SETTING_REG) != record.setting_reg) ||
+        (fake_transport.get_register(replay_address, POWER_SAVE_REG) != record.power_save_reg)) {
+        fake_transport.set_register(replay_address, SETTING_REG, record.setting_reg);
+        fake_transport.set_register(replay_address, POWER_SAVE_REG, record.power_save_reg);
+        sensor.validate_shadow_registers();
+    }
+    fake_transport.set_register(replay_address, AMBIENT_LIGHT_DATA_REG, record.ambient_light_bits);
+    fake_transport.set_register(replay_address, WHITE_LIGHT_DATA_REG, record.white_light_bits);
+    return sensor.read_sample(sample);
+}
+
+// This function is the body of the replay thread. The timeline is mapped onto
+// real time from the moment the thread starts: a sample t ns after the first one
+// on the timeline is released t / speed ns after the start.
+void veml6030_replay::run() {
+    veml6030_capture_record record;
+    veml6030_timed_sample timed_sample;
+    int64_t first_timestamp_ns = 0;
+    int64_t start_ns = veml6030_monotonic_ns();
+    uint32_t sequence = 0;
+    bool as_fast_as_possible = (speed <= 0.0);
+
+    /* Start from the file's configuration so the first sample isn't counted as a change. */
+    if (reader.next(record)) {
+        first_timestamp_ns = record.timestamp_ns;
+        start_timeline(record);
+        fake_transport.set_register(replay_address, SETTING_REG, record.setting_reg);
+        fake_transport.set_register(replay_address, POWER_SAVE_REG, record.power_save_reg);
+        sensor.validate_shadow_registers();
+        reader.rewind();
+    }
+    while (reader.next(record)) {
+        int64_t record_timeline_ns = timeline_ns(record);
+
+        if (!as_fast_as_possible) {
+            int64_t due_ns = start_ns + (int64_t)((record_timeline_ns - first_timestamp_ns) / speed);
+
+            if (!wait_until(due_ns)) {
+                return;
+            }
+        }
+        if (!replay_record(record, timed_sample.sample)) {
+            continue;
+        }
+        timed_sample.timestamp_ns = record_timeline_ns;
+        timed_sample.sequence = ++sequence;
+        if (as_fast_as_possible) {
+            /* Wait for the consumer rather than drop, so every sample is processed. */
+            while (!samples.push(timed_sample)) {
+                struct pollfd stop_wait;
+
+                stop_wait.fd = stop_fd;
+                stop_wait.events = POLLIN;
+                if (poll(&stop_wait, 1, 1) > 0) {
+                    return;
+                }
+            }
+        } else if (!samples.push(timed_sample)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        replayed.fetch_add(1, std::memory_order_relaxed);
+    }
+    done.store(true, std::memory_order_release);
+}
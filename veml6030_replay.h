@@ -0,0 +1,95 @@
+#ifndef _VEML6030_REPLAY_H_
+#define _VEML6030_REPLAY_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_acquisition.h"
+#include "veml6030_capture.h"
+#include "veml6030_fake_transport.h"
+
+// Replays a capture file as if it were a live sensor. Each recorded sample is
+// loaded into a fake transport's registers and read back through the driver's
+// read_sample(), so it takes the same conversion path as live data, then queued
+// in the same kind of ring as veml6030_acquisition uses.
+//
+// A capture file can hold several recording sessions, appended across restarts
+// and reboots, each with its own CLOCK_MONOTONIC. The replay joins them into one
+// timeline using each record's own epoch offset: replayed timestamps are on the
+// first session's clock, so get_epoch_ms_offset() turns every one of them into
+// its recorded wall time, and they never go backwards. That timeline is the
+// replay's virtual clock. With a speed of 1 samples are released in real time,
+// with a speed of N at N times real time, and with a speed of 0 as fast as the
+// consumer drains them (no samples are dropped in that mode, so it measures the
+// pipeline's throughput).
+class veml6030_replay : public veml6030_sample_source {
+  public:
+    static const int replay_address = 0x48;
+
+    veml6030_replay();
+    ~veml6030_replay();
+
+    // This function opens a capture file. It returns false if the file couldn't be
+    // opened or holds no samples.
+    bool open(const char *file_name, double speed = 1.0);
+
+    // This function returns the offset to add to a replayed sample timestamp in ms
+    // to get ms since the epoch. It is the first session's offset, which holds for
+    // every replayed sample.
+    int64_t get_epoch_ms_offset() const;
+
+    // These functions start and stop the replay thread.
+    void start();
+    void stop();
+
+    size_t drain(veml6030_timed_sample *samples, size_t max_count);
+    unsigned long dropped_samples() const;
+
+    // Number of samples replayed so far, and true once the whole file has been.
+    unsigned long replayed_samples() const;
+    bool finished() const;
+
+  private:
+    veml6030_capture_reader reader;
+    fake_veml6030_transport fake_transport;
+    SparkFun_Ambient_Light sensor;
+    double speed;
+    int64_t epoch_ms_offset;
+    std::atomic<unsigned long> dropped;
+    std::atomic<unsigned long> replayed;
+    std::atomic<bool> done;
+
+    // Timeline state. Records of the current session are moved onto the first
+    // session's clock by segment_offset_ns.
+    int64_t segment_epoch_ms_offset;
+    int64_t segment_offset_ns;
+    int64_t last_recorded_ns;
+    int64_t last_timeline_ns;
+    sample_ring samples;
+
+    std::thread replay_thread;
+    int stop_fd;
+    int timer_fd;
+
+    // This function is the body of the replay thread.
+    void run();
+
+    // This function waits until the CLOCK_MONOTONIC time due_ns or a stop request.
+    // It returns false if stop was requested.
+    bool wait_until(int64_t due_ns);
+
+    // This function starts the timeline at record, the first one in the file.
+    void start_timeline(const veml6030_capture_record &record);
+
+    // This function returns record's time on the replay timeline.
+    int64_t timeline_ns(const veml6030_capture_record &record);
+
+    // This function loads a recorded sample into the fake sensor and reads it back
+    // through the driver.
+    bool replay_record(const veml6030_capture_record &record, veml6030_sample &sample);
+
+    veml6030_replay(const veml6030_replay &) = delete;
+    veml6030_replay &operator=(const veml6030_replay &) = delete;
+};
+#endif
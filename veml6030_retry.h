@@ -0,0 +1,56 @@
+#ifndef _VEML6030_RETRY_H_
+#define _VEML6030_RETRY_H_
+
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_i2c_stats.h"
+#include "veml6030_clock.h"
+
+// This function returns true for errors that may go away if the access is
+// repeated: lost arbitration, a NAK from a busy sensor, or an adapter timeout.
+inline bool veml6030_is_transient_error(int status) {
+    return ((status == -EAGAIN) || (status == -EREMOTEIO) || (status == -ETIMEDOUT));
+}
+
+// This function returns true for errors of the bus itself that may go away if a
+// batch is repeated: lost arbitration or an adapter timeout. A NAK isn't one,
+// since in a batch for several sensors it usually means one of them is missing.
+inline bool veml6030_is_transient_bus_error(int status) {
+    return ((status == -EAGAIN) || (status == -ETIMEDOUT));
+}
+
+// This function runs access (which returns 0 or a negative errno value) under
+// policy, sleeping backoff_ns between attempts, and returns its final status.
+// Only errors is_transient accepts are retried. Retries are counted in stats.
+// The clock is only read once an attempt has failed, so a successful access
+// costs nothing extra. It is shared by the driver's register accesses and the
+// bus manager's batches.
+template <typename Access>
+int veml6030_retry_access(const veml6030_retry_policy &policy, veml6030_i2c_stats &stats, Access access,
+                          bool (*is_transient)(int status) = veml6030_is_transient_error) {
+    int64_t first_failure_ns = 0;
+    int status;
+
+    for (int attempt = 1;; ++attempt) {
+        struct timespec backoff;
+
+        status = access();
+        if ((status == 0) || !is_transient(status) || (attempt >= policy.max_attempts)) {
+            break;
+        }
+        if (attempt == 1) {
+            first_failure_ns = veml6030_monotonic_ns();
+        }
+        if ((veml6030_monotonic_ns() + policy.backoff_ns - first_failure_ns) > policy.deadline_ns) {
+            break;
+        }
+        stats.record_retry();
+        backoff.tv_sec = policy.backoff_ns / 1000000000;
+        backoff.tv_nsec = policy.backoff_ns % 1000000000;
+        nanosleep(&backoff, NULL);
+    }
+    return status;
+}
+#endif
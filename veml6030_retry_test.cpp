@@ -0,0 +1,122 @@
+#include <errno.h>
+#include <stdint.h>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_bus_manager.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_test.h"
+
+// This function checks the transport's retry counter. Without VEML6030_I2C_STATS
+// the counters are compiled out and always read 0, so there is nothing to check.
+static void check_retry_count(veml6030_transport &transport, uint64_t retries) {
+#ifdef VEML6030_I2C_STATS
+    veml6030_i2c_stats_snapshot snapshot;
+
+    transport.get_stats().snapshot(snapshot);
+    VEML6030_CHECK(snapshot.retries == retries);
+#else
+    (void)transport;
+    (void)retries;
+#endif
+}
+
+// Transient errors are retried and the access succeeds.
+static void test_transient_retry() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    uint32_t lux = 0;
+
+    transport.set_register(0x48, AMBIENT_LIGHT_DATA_REG, 1000);
+    transport.reset_counts();
+    transport.inject_failures(2, -EREMOTEIO);
+    VEML6030_CHECK(light.read_light(lux));
+    VEML6030_CHECK(lux > 0);
+    VEML6030_CHECK(light.get_last_status() == 0);
+    VEML6030_CHECK(transport.read_count() == 3);
+    check_retry_count(transport, 2);
+}
+
+// A failure that triggers recovery is still reported after recovery succeeds,
+// and the reading can't be mistaken for a real one.
+static void test_status_survives_recovery() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    veml6030_retry_policy policy = {1, 0, 0, 1};
+    uint32_t lux = 1234;
+
+    light.set_retry_policy(policy);
+    transport.inject_failures(1, -EIO);
+    VEML6030_CHECK(!light.read_light(lux));
+    VEML6030_CHECK(lux == 1234);
+    VEML6030_CHECK(light.get_last_status() == -EIO);
+    VEML6030_CHECK(light.get_recoveries() == 1);
+    VEML6030_CHECK(transport.reopen_count() == 1);
+
+    transport.inject_failures(1, -EIO);
+    VEML6030_CHECK(light.read_light() == 0);
+    VEML6030_CHECK(light.get_last_status() == -EIO);
+
+    VEML6030_CHECK(light.read_white_light(lux));
+    VEML6030_CHECK(light.get_last_status() == 0);
+}
+
+// Batched reads are retried on transient bus errors but not on a NAK, and
+// repeated batch failures recover the shared bus once for both sensors.
+static void test_bus_manager_batches() {
+    fake_veml6030_transport transport(0x48);
+    veml6030_bus_manager manager;
+    veml6030_sample samples[2];
+    bool sample_ok[2];
+
+    transport.add_device(0x10);
+    VEML6030_CHECK(manager.add_sensor(&transport, 0x48) == 0);
+    VEML6030_CHECK(manager.add_sensor(&transport, 0x10) == 1);
+
+    transport.reset_counts();
+    transport.inject_failures(2, -ETIMEDOUT);
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 2);
+    VEML6030_CHECK(sample_ok[0] && sample_ok[1]);
+    VEML6030_CHECK(transport.read_count() == 3);
+    check_retry_count(transport, 2);
+
+    /* A NAK splits the batch instead of repeating it. */
+    transport.reset_counts();
+    transport.inject_failures(1, -EREMOTEIO);
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 2);
+    VEML6030_CHECK(transport.read_count() == 3);
+    check_retry_count(transport, 2);
+
+    /* The default policy recovers after 5 failed accesses in a row. */
+    for (int i = 0; i < 5; ++i) {
+        transport.inject_failures(1, -EIO);
+        VEML6030_CHECK(manager.poll(samples, sample_ok) == 0);
+    }
+    VEML6030_CHECK(!sample_ok[0] && !sample_ok[1]);
+    for (int s = 0; s < 2; ++s) {
+        VEML6030_CHECK(manager.sensor(s)->get_last_status() == -EIO);
+        VEML6030_CHECK(manager.sensor(s)->get_recoveries() == 1);
+    }
+    VEML6030_CHECK(transport.reopen_count() == 1);
+
+    VEML6030_CHECK(manager.poll(samples, sample_ok) == 2);
+    VEML6030_CHECK(manager.sensor(0)->get_last_status() == 0);
+
+    /* A missing sensor is recovered on its own, and its NAKs aren't retried. */
+    transport.remove_device(0x10);
+    transport.reset_counts();
+    for (int i = 0; i < 5; ++i) {
+        VEML6030_CHECK(manager.poll(samples, sample_ok) == 1);
+    }
+    VEML6030_CHECK(manager.sensor(1)->get_last_status() == -ENXIO);
+    VEML6030_CHECK(manager.sensor(1)->get_recoveries() == 2);
+    VEML6030_CHECK(manager.sensor(0)->get_recoveries() == 1);
+    VEML6030_CHECK(transport.reopen_count() == 2);
+    check_retry_count(transport, 2);
+}
+
+int main() {
+    test_transient_retry();
+    test_status_survives_recovery();
+    test_bus_manager_batches();
+    return veml6030_test_result();
+}
@@ -0,0 +1,321 @@
+#include <stdint.h>
+
+#include "veml6030_rollup.h"
+
+// Bucket lengths of the tiers, indexed by tier.
+static const int64_t tier_bucket_ms[veml6030_rollup_store::tier_count] = {0, 1000, 60 * 1000, 60 * 60 * 1000};
+
+// This function returns the start of the bucket_ms long bucket holding time_ms.
+static int64_t bucket_start_ms(int64_t time_ms, int64_t bucket_ms) {
+    int64_t offset_ms = time_ms % bucket_ms;
+
+    return time_ms - ((offset_ms < 0) ? (offset_ms + bucket_ms) : offset_ms);
+}
+
+// This function adds a bucket's minimum and maximum to points in time order.
+static void append_extremes(const veml6030_rollup_bucket &summary, std::vector<veml6030_chart_point> &points) {
+    veml6030_chart_point point;
+    bool min_first = (summary.min_time_ms <= summary.max_time_ms);
+
+    point.time_ms = min_first ? summary.min_time_ms : summary.max_time_ms;
+    point.value = min_first ? summary.min : summary.max;
+    points.push_back(point);
+    if (summary.min_time_ms != summary.max_time_ms) {
+        point.time_ms = min_first ? summary.max_time_ms : summary.min_time_ms;
+        point.value = min_first ? summary.max : summary.min;
+        points.push_back(point);
+    }
+}
+
+const veml6030_rollup_bucket &veml6030_rollup_store::bucket_ring::at(size_t i) const {
+    size_t slot = first + i;
+
+    if (slot >= buckets.size()) {
+        slot -= buckets.size();
+    }
+    return buckets[slot];
+}
+
+veml6030_rollup_bucket &veml6030_rollup_store::bucket_ring::newest() {
+    return const_cast<veml6030_rollup_bucket &>(at(count - 1));
+}
+
+void veml6030_rollup_store::bucket_ring::push(const veml6030_rollup_bucket &new_bucket) {
+    size_t slot = first + count;
+
+    if (slot >= buckets.size()) {
+        slot -= buckets.size();
+    }
+    buckets[slot] = new_bucket;
+    if (count < buckets.size()) {
+        ++count;
+    } else {
+        wrapped = true;
+        if (++first == buckets.size()) {
+            first = 0;
+        }
+    }
+}
+
+size_t veml6030_rollup_store::bucket_ring::lower_bound(int64_t start_ms) const {
+    size_t low = 0;
+    size_t high = count;
+
+    while (low < high) {
+        size_t middle = low + ((high - low) / 2);
+
+        if (at(middle).start_ms < start_ms) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+veml6030_rollup_store::veml6030_rollup_store(size_t raw_capacity, size_t second_capacity, size_t minute_capacity,
+                                             size_t hour_capacity)
+    : raw_points(raw_capacity),
+      raw_wrapped(false),
+      first_time_ms(0),
+      hour_extrema((hour_capacity > 1) ? (hour_capacity - 1) : 1) {
+    size_t capacities[tier_count] = {0, second_capacity, minute_capacity, hour_capacity};
+
+    for (int t = second_tier; t < tier_count; ++t) {
+        rollups[t].buckets.resize((capacities[t] > 0) ? capacities[t] : 1);
+        rollups[t].first = 0;
+        rollups[t].count = 0;
+        rollups[t].wrapped = false;
+    }
+}
+
+// This function folds the point into the newest bucket of each tier, or starts
+// a new bucket aligned to the tier's bucket length if the point is past it.
+void veml6030_rollup_store::append(int64_t time_ms, double value) {
+    if (raw_points.size() == raw_points.capacity()) {
+        raw_wrapped = true;
+    }
+    if (empty()) {
+        first_time_ms = time_ms;
+    }
+    raw_points.append(time_ms, value);
+    for (int t = second_tier; t < tier_count; ++t) {
+        bucket_ring &ring = rollups[t];
+
+        if ((ring.count == 0) || (time_ms >= (ring.newest().start_ms + tier_bucket_ms[t]))) {
+            veml6030_rollup_bucket new_bucket;
+
+            /* The ring keeps the completed bucket only if it has room for two. */
+            if ((t == hour_tier) && (ring.count > 0) && (ring.buckets.size() > 1)) {
+                hour_extrema.push(ring.newest().min, ring.newest().max);
+            }
+
+            new_bucket.start_ms = bucket_start_ms(time_ms, tier_bucket_ms[t]);
+            new_bucket.min_time_ms = time_ms;
+            new_bucket.max_time_ms = time_ms;
+            new_bucket.min = value;
+            new_bucket.max = value;
+            new_bucket.sum = value;
+            new_bucket.count = 1;
+            ring.push(new_bucket);
+        } else {
+            veml6030_rollup_bucket &current = ring.newest();
+
+            if (value < current.min) {
+                current.min = value;
+                current.min_time_ms = time_ms;
+            }
+            if (value > current.max) {
+                current.max = value;
+                current.max_time_ms = time_ms;
+            }
+            current.sum += value;
+            ++current.count;
+        }
+    }
+}
+
+void veml6030_rollup_store::clear() {
+    raw_points.clear();
+    raw_wrapped = false;
+    for (int t = second_tier; t < tier_count; ++t) {
+        rollups[t].first = 0;
+        rollups[t].count = 0;
+        rollups[t].wrapped = false;
+    }
+    hour_extrema.clear();
+}
+
+bool veml6030_rollup_store::empty() const {
+    return (raw_points.size() == 0);
+}
+
+// This function returns the time of the first point appended until the hour
+// tier wraps, and then the start of its oldest bucket.
+int64_t veml6030_rollup_store::oldest_ms() const {
+    if (rollups[hour_tier].wrapped) {
+        return rollups[hour_tier].at(0).start_ms;
+    }
+    return first_time_ms;
+}
+
+int64_t veml6030_rollup_store::newest_ms() const {
+    return raw_points.newest().time_ms;
+}
+
+// These functions combine the completed hour buckets still in the ring, from the
+// tracker, with the hour bucket being filled.
+double veml6030_rollup_store::min_value() const {
+    const veml6030_rollup_bucket &current = rollups[hour_tier].at(rollups[hour_tier].count - 1);
+
+    if (hour_extrema.empty() || (current.min < hour_extrema.min())) {
+        return current.min;
+    }
+    return hour_extrema.min();
+}
+
+double veml6030_rollup_store::max_value() const {
+    const veml6030_rollup_bucket &current = rollups[hour_tier].at(rollups[hour_tier].count - 1);
+
+    if (hour_extrema.empty() || (current.max > hour_extrema.max())) {
+        return current.max;
+    }
+    return hour_extrema.max();
+}
+
+int64_t veml6030_rollup_store::bucket_ms(tier rollup_tier) {
+    return tier_bucket_ms[rollup_tier];
+}
+
+size_t veml6030_rollup_store::bucket_count(tier rollup_tier) const {
+    return rollups[rollup_tier].count;
+}
+
+const veml6030_rollup_bucket &veml6030_rollup_store::bucket(tier rollup_tier, size_t i) const {
+    return rollups[rollup_tier].at(i);
+}
+
+const veml6030_chart_history &veml6030_rollup_store::raw() const {
+    return raw_points;
+}
+
+bool veml6030_rollup_store::tier_covers(tier rollup_tier, int64_t start_ms) const {
+    if (rollup_tier == raw_tier) {
+        return (!raw_wrapped || (raw_points.oldest().time_ms <= start_ms));
+    }
+    return (!rollups[rollup_tier].wrapped || (rollups[rollup_tier].at(0).start_ms <= start_ms));
+}
+
+size_t veml6030_rollup_store::raw_lower_bound(int64_t time_ms) const {
+    size_t low = 0;
+    size_t high = raw_points.size();
+
+    while (low < high) {
+        size_t middle = low + ((high - low) / 2);
+
+        if (raw_points.at(middle).time_ms < time_ms) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// This function checks the tiers from finest to coarsest. The raw tier is only
+// used if the points in the span fit without decimation, since decimating them
+// would cost time proportional to their number.
+veml6030_rollup_store::tier veml6030_rollup_store::select_tier(int64_t start_ms, int64_t end_ms,
+                                                               size_t max_buckets) const {
+    int64_t span_ms = (end_ms - start_ms) + 1;
+
+    if (empty() || (span_ms <= 0)) {
+        return raw_tier;
+    }
+    if (tier_covers(raw_tier, start_ms) &&
+        ((raw_lower_bound(end_ms + 1) - raw_lower_bound(start_ms)) <= (2 * max_buckets))) {
+        return raw_tier;
+    }
+    for (int t = second_tier; t < hour_tier; ++t) {
+        if (tier_covers((tier)t, start_ms) && ((span_ms / tier_bucket_ms[t]) <= (int64_t)max_buckets)) {
+            return (tier)t;
+        }
+    }
+    return hour_tier;
+}
+
+// This function copies the raw points or bucket extremes in the span. When the
+// hour tier has more buckets in the span than asked for, it merges them into
+// groups a whole number of hours long, aligned to that length so the groups
+// don't shift as the span moves.
+veml6030_rollup_store::tier veml6030_rollup_store::query(int64_t start_ms, int64_t end_ms, size_t max_buckets,
+                                                         std::vector<veml6030_chart_point> &points,
+                                                         std::vector<veml6030_rollup_bucket> *summaries) const {
+    tier chosen = select_tier(start_ms, end_ms, max_buckets);
+    veml6030_rollup_bucket group;
+    int64_t group_ms;
+    size_t first;
+    size_t end;
+
+    points.clear();
+    if (summaries) {
+        summaries->clear();
+    }
+    if (empty()) {
+        return chosen;
+    }
+    if (chosen == raw_tier) {
+        end = raw_lower_bound(end_ms + 1);
+        for (size_t i = raw_lower_bound(start_ms); i < end; ++i) {
+            points.push_back(raw_points.at(i));
+        }
+        return chosen;
+    }
+    const bucket_ring &ring = rollups[chosen];
+
+    /* Start with the bucket holding start_ms, which may begin before it. */
+    first = ring.lower_bound(start_ms - tier_bucket_ms[chosen] + 1);
+    end = ring.lower_bound(end_ms + 1);
+    if (first >= end) {
+        return chosen;
+    }
+    group_ms = tier_bucket_ms[chosen];
+    if ((chosen == hour_tier) && ((end - first) > max_buckets)) {
+        int64_t span_buckets = ((ring.at(end - 1).start_ms - ring.at(first).start_ms) / group_ms) + 1;
+        int64_t group_count = (max_buckets > 2) ? (int64_t)(max_buckets - 1) : 1;
+
+        /* Aligned groups of ceil(span / (max_buckets - 1)) hours: at most max_buckets of them. */
+        group_ms *= (span_buckets + group_count - 1) / group_count;
+    }
+
+    group = ring.at(first);
+    group.start_ms = bucket_start_ms(group.start_ms, group_ms);
+    for (size_t i = first + 1; i < end; ++i) {
+        const veml6030_rollup_bucket &summary = ring.at(i);
+
+        if (summary.start_ms >= (group.start_ms + group_ms)) {
+            append_extremes(group, points);
+            if (summaries) {
+                summaries->push_back(group);
+            }
+            group = summary;
+            group.start_ms = bucket_start_ms(summary.start_ms, group_ms);
+            continue;
+        }
+        if (summary.min < group.min) {
+            group.min = summary.min;
+            group.min_time_ms = summary.min_time_ms;
+        }
+        if (summary.max > group.max) {
+            group.max = summary.max;
+            group.max_time_ms = summary.max_time_ms;
+        }
+        group.sum += summary.sum;
+        group.count += summary.count;
+    }
+    append_extremes(group, points);
+    if (summaries) {
+        summaries->push_back(group);
+    }
+    return chosen;
+}
@@ -0,0 +1,139 @@
+#ifndef _VEML6030_ROLLUP_H_
+#define _VEML6030_ROLLUP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "veml6030_chart_history.h"
+#include "veml6030_window_extrema.h"
+
+// Summary of the values in one time bucket. The times of the extremes are kept
+// so a chart can draw them in time order.
+struct veml6030_rollup_bucket {
+    int64_t start_ms;
+    int64_t min_time_ms;
+    int64_t max_time_ms;
+    double min;
+    double max;
+    double sum;
+    uint32_t count;
+
+    double mean() const {
+        return (count > 0) ? (sum / count) : 0;
+    }
+};
+
+// Raw points plus 1 second, 1 minute and 1 hour rollups of them, each in its own
+// fixed capacity ring. Every appended point updates the newest bucket of each
+// tier, so the rollups cost O(1) per point and memory is bounded whatever the
+// uptime. With the default capacities the raw tier holds 65536 points, the
+// second tier 6 hours, the minute tier a week and the hour tier a year, in
+// about 3.6MB.
+//
+// Queries pick the finest tier that covers the requested span in no more than
+// the requested number of buckets, so drawing any span costs about the same.
+// Spans too long even for the hour tier merge its buckets, so a query never
+// returns more than two points per requested bucket. The extrema of everything
+// the store covers are kept by a sliding window tracker over the completed hour
+// buckets, so an axis fitted to them costs O(1) whatever the span.
+class veml6030_rollup_store {
+  public:
+    enum tier {
+        raw_tier = 0,
+        second_tier,
+        minute_tier,
+        hour_tier,
+        tier_count
+    };
+
+    static const size_t default_raw_capacity = veml6030_chart_history::default_capacity;
+    static const size_t default_second_capacity = 6 * 60 * 60;
+    static const size_t default_minute_capacity = 7 * 24 * 60;
+    static const size_t default_hour_capacity = 366 * 24;
+
+    veml6030_rollup_store(size_t raw_capacity = default_raw_capacity,
+                          size_t second_capacity = default_second_capacity,
+                          size_t minute_capacity = default_minute_capacity,
+                          size_t hour_capacity = default_hour_capacity);
+
+    // This function adds a point to the raw tier and every rollup. Points must be
+    // added in time order.
+    void append(int64_t time_ms, double value);
+
+    void clear();
+    bool empty() const;
+
+    // These functions return the start of the time the store still covers (in
+    // the hour tier) and the time of the newest point. The store must not be
+    // empty.
+    int64_t oldest_ms() const;
+    int64_t newest_ms() const;
+
+    // These functions return the smallest and largest values from oldest_ms() to
+    // newest_ms(), which is everything a query of that span draws. The store must
+    // not be empty.
+    double min_value() const;
+    double max_value() const;
+
+    // This function returns the bucket length of a rollup tier in milliseconds (0
+    // for the raw tier).
+    static int64_t bucket_ms(tier rollup_tier);
+
+    // These functions give access to a rollup tier's buckets, oldest first.
+    size_t bucket_count(tier rollup_tier) const;
+    const veml6030_rollup_bucket &bucket(tier rollup_tier, size_t i) const;
+
+    // This function returns the raw tier.
+    const veml6030_chart_history &raw() const;
+
+    // This function returns the finest tier that holds the whole of start_ms to
+    // end_ms in at most max_buckets buckets (or raw points), falling back to the
+    // hour tier.
+    tier select_tier(int64_t start_ms, int64_t end_ms, size_t max_buckets) const;
+
+    // This function fills points with start_ms to end_ms from the tier picked by
+    // select_tier(): raw points as they are, or the minimum and maximum of each
+    // bucket in time order. Buckets overlapping either end are included whole.
+    // If the span has more than max_buckets hour buckets, runs of them aligned
+    // to a multiple of an hour are merged so that there are at most max_buckets
+    // (at least 2). It returns the tier used. Apart from a binary search, the
+    // work done is bounded by max_buckets for the finer tiers and by the hour
+    // tier's capacity when the hour buckets are merged.
+    //
+    // If summaries isn't null, it is filled with the buckets (or merged groups)
+    // the points came from, for their means and counts. It is left empty when
+    // the raw tier is used.
+    tier query(int64_t start_ms, int64_t end_ms, size_t max_buckets,
+               std::vector<veml6030_chart_point> &points,
+               std::vector<veml6030_rollup_bucket> *summaries = nullptr) const;
+
+  private:
+    // A fixed capacity ring of buckets for one rollup tier.
+    struct bucket_ring {
+        std::vector<veml6030_rollup_bucket> buckets;
+        size_t first;
+        size_t count;
+        bool wrapped; // Set once the oldest bucket has been overwritten
+
+        const veml6030_rollup_bucket &at(size_t i) const;
+        veml6030_rollup_bucket &newest();
+        void push(const veml6030_rollup_bucket &new_bucket);
+
+        // This function returns the index of the first bucket starting at or after start_ms.
+        size_t lower_bound(int64_t start_ms) const;
+    };
+
+    veml6030_chart_history raw_points;
+    bool raw_wrapped;
+    int64_t first_time_ms;
+    bucket_ring rollups[tier_count];
+    veml6030_window_extrema hour_extrema; // Over the completed buckets in the hour ring
+
+    // This function returns true if the tier still holds everything since
+    // start_ms (or everything ever appended).
+    bool tier_covers(tier rollup_tier, int64_t start_ms) const;
+
+    // This function returns the index of the first raw point at or after time_ms.
+    size_t raw_lower_bound(int64_t time_ms) const;
+};
+#endif
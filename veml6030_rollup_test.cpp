@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <vector>
+
+#include "veml6030_rollup.h"
+#include "veml6030_test.h"
+
+// This function returns true if points are in time order.
+static bool in_time_order(const std::vector<veml6030_chart_point> &points) {
+    for (size_t i = 1; i < points.size(); ++i) {
+        if (points[i].time_ms < points[i - 1].time_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// This function returns the largest value in points (0 if there are none).
+static double largest_value(const std::vector<veml6030_chart_point> &points) {
+    double largest = 0;
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (points[i].value > largest) {
+            largest = points[i].value;
+        }
+    }
+    return largest;
+}
+
+// A short span is returned as the raw points themselves.
+static void test_raw_query() {
+    veml6030_rollup_store store;
+    std::vector<veml6030_chart_point> points;
+
+    for (int i = 0; i < 100; ++i) {
+        store.append(1000000 + (i * 100), i);
+    }
+    VEML6030_CHECK(store.oldest_ms() == 1000000);
+    VEML6030_CHECK(store.newest_ms() == 1009900);
+    VEML6030_CHECK(store.query(1000000, 1004900, 100, points) == veml6030_rollup_store::raw_tier);
+    VEML6030_CHECK(points.size() == 50);
+    VEML6030_CHECK((points.front().time_ms == 1000000) && (points.back().time_ms == 1004900));
+    VEML6030_CHECK(points[10].value == 10);
+}
+
+// Every point lands in the right bucket of each rollup tier.
+static void test_buckets() {
+    veml6030_rollup_store store;
+
+    /* 10 points a second for 2 minutes, with a spike and a dip in the second second. */
+    for (int i = 0; i < 1200; ++i) {
+        double value = 50;
+
+        if (i == 13) {
+            value = 900;
+        } else if (i == 17) {
+            value = 2;
+        }
+        store.append(60000 + (i * 100), value);
+    }
+    VEML6030_CHECK(store.bucket_count(veml6030_rollup_store::second_tier) == 120);
+    VEML6030_CHECK(store.bucket_count(veml6030_rollup_store::minute_tier) == 2);
+    VEML6030_CHECK(store.bucket_count(veml6030_rollup_store::hour_tier) == 1);
+
+    const veml6030_rollup_bucket &second = store.bucket(veml6030_rollup_store::second_tier, 1);
+    VEML6030_CHECK(second.start_ms == 61000);
+    VEML6030_CHECK(second.count == 10);
+    VEML6030_CHECK((second.max == 900) && (second.max_time_ms == 61300));
+    VEML6030_CHECK((second.min == 2) && (second.min_time_ms == 61700));
+    VEML6030_CHECK((second.sum == 1302) && (second.mean() == 130.2));
+
+    const veml6030_rollup_bucket &minute = store.bucket(veml6030_rollup_store::minute_tier, 0);
+    VEML6030_CHECK(minute.start_ms == 60000);
+    VEML6030_CHECK(minute.count == 600);
+    VEML6030_CHECK((minute.min == 2) && (minute.max == 900));
+    VEML6030_CHECK(minute.sum == 30802);
+}
+
+// A span with too many raw points comes from the finest tier that fits, as
+// minimum and maximum pairs that keep the extremes.
+static void test_rollup_query() {
+    veml6030_rollup_store store;
+    std::vector<veml6030_chart_point> points;
+
+    /* 10 points a second for 10 minutes. */
+    for (int i = 0; i < 6000; ++i) {
+        store.append(i * 100, (i == 4321) ? 5000 : (i % 10));
+    }
+    VEML6030_CHECK(store.query(store.oldest_ms(), store.newest_ms(), 1000, points) ==
+                   veml6030_rollup_store::second_tier);
+    VEML6030_CHECK(points.size() <= 2000);
+    VEML6030_CHECK(in_time_order(points));
+    VEML6030_CHECK(largest_value(points) == 5000);
+
+    VEML6030_CHECK(store.query(store.oldest_ms(), store.newest_ms(), 100, points) ==
+                   veml6030_rollup_store::minute_tier);
+    VEML6030_CHECK(points.size() <= 200);
+    VEML6030_CHECK(in_time_order(points));
+    VEML6030_CHECK(largest_value(points) == 5000);
+}
+
+// Spans longer than max_buckets hours merge hour buckets, so the output stays
+// within two points per requested bucket whatever the span. The merged groups
+// keep the sum and count of every point in them.
+static void test_hour_tier_bound() {
+    veml6030_rollup_store store(16, 16, 16, 100);
+    std::vector<veml6030_chart_point> points;
+    std::vector<veml6030_rollup_bucket> summaries;
+    const int64_t hour_ms = 60 * 60 * 1000;
+
+    /* A point every 10 minutes for 100 hours, with one spike. */
+    for (int64_t time_ms = 0; time_ms < (100 * hour_ms); time_ms += 10 * 60 * 1000) {
+        store.append(time_ms, (time_ms == (50 * hour_ms)) ? 1000 : 1);
+    }
+    VEML6030_CHECK(store.bucket_count(veml6030_rollup_store::hour_tier) == 100);
+
+    VEML6030_CHECK(store.query(store.oldest_ms(), store.newest_ms(), 200, points) ==
+                   veml6030_rollup_store::hour_tier);
+    /* One point per flat bucket, two for the bucket with the spike. */
+    VEML6030_CHECK(points.size() == 101);
+
+    for (size_t max_buckets = 2; max_buckets < 100; max_buckets += 7) {
+        store.query(store.oldest_ms(), store.newest_ms(), max_buckets, points);
+        VEML6030_CHECK(points.size() <= (2 * max_buckets));
+        VEML6030_CHECK(in_time_order(points));
+        VEML6030_CHECK(largest_value(points) == 1000);
+    }
+
+    store.query(store.oldest_ms(), store.newest_ms(), 10, points, &summaries);
+    VEML6030_CHECK((summaries.size() > 1) && (summaries.size() <= 10));
+    double total = 0;
+    uint32_t total_count = 0;
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        total += summaries[i].sum;
+        total_count += summaries[i].count;
+    }
+    VEML6030_CHECK((total == 1599) && (total_count == 600));
+    VEML6030_CHECK(summaries[0].mean() == 1);
+
+    VEML6030_CHECK(store.query(store.newest_ms(), store.newest_ms(), 10, points, &summaries) ==
+                   veml6030_rollup_store::raw_tier);
+    VEML6030_CHECK(summaries.empty());
+}
+
+// Once the hour tier wraps, the store reports the start of its oldest bucket.
+static void test_wrap() {
+    veml6030_rollup_store store(16, 16, 16, 4);
+    const int64_t hour_ms = 60 * 60 * 1000;
+
+    for (int64_t hour = 0; hour < 10; ++hour) {
+        store.append((hour * hour_ms) + 1234, hour);
+    }
+    VEML6030_CHECK(store.bucket_count(veml6030_rollup_store::hour_tier) == 4);
+    VEML6030_CHECK(store.oldest_ms() == (6 * hour_ms));
+
+    store.clear();
+    VEML6030_CHECK(store.empty());
+    store.append(5000, 1);
+    VEML6030_CHECK(store.oldest_ms() == 5000);
+}
+
+int main() {
+    test_raw_query();
+    test_buckets();
+    test_rollup_query();
+    test_hour_tier_bound();
+    test_wrap();
+    return veml6030_test_result();
+}
@@ -0,0 +1,89 @@
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SparkFun_VEML6030_Ambient_Light_Sensor.h"
+#include "veml6030_conversion_scheduler.h"
+#include "veml6030_fake_transport.h"
+#include "veml6030_test.h"
+
+// This function returns the CLOCK_MONOTONIC time in nanoseconds.
+static int64_t monotonic_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Only writes that change the gain, integration time, power saving or shutdown
+// state move the conversion clock; rereading the registers or changing the
+// interrupt and persistence bits leaves it alone.
+static void test_config_generation() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+
+    light.set_integration_time(25);
+    uint32_t generation = light.get_config_generation();
+    int64_t change_ns = light.get_config_change_ns();
+
+    VEML6030_CHECK(light.validate_shadow_registers());
+    light.enable_interrupt();
+    light.set_protect(2);
+    light.set_gain(light.read_gain());
+    VEML6030_CHECK(light.get_config_generation() == generation);
+    VEML6030_CHECK(light.get_config_change_ns() == change_ns);
+
+    light.set_gain(2);
+    VEML6030_CHECK(light.get_config_generation() != generation);
+    generation = light.get_config_generation();
+
+    /* A change made behind the driver's back is picked up on revalidation. */
+    uint16_t setting = light.read_register_checked(SETTING_REG).value;
+    transport.set_register(0x48, SETTING_REG, (setting & ~INTEGRATION_TIME_MASK) | (2 << INTEGRATION_TIME_POS));
+    VEML6030_CHECK(!light.validate_shadow_registers());
+    VEML6030_CHECK(light.get_config_generation() != generation);
+    generation = light.get_config_generation();
+    VEML6030_CHECK(light.validate_shadow_registers());
+    VEML6030_CHECK(light.get_config_generation() == generation);
+}
+
+// Reads land just after each conversion completes, early polls are dropped, and
+// enabling the interrupt doesn't restart the cycle.
+static void test_alignment() {
+    fake_veml6030_transport transport(0x48);
+    SparkFun_Ambient_Light light(&transport, 0x48);
+    veml6030_sample sample;
+    uint32_t sequence;
+
+    light.set_integration_time(25);
+    light.power_on();
+    veml6030_conversion_scheduler scheduler(&light);
+    VEML6030_CHECK(scheduler.get_period_ms() == 25);
+    int64_t cycle_start = light.get_config_change_ns();
+
+    VEML6030_CHECK(!scheduler.poll(sample, sequence));
+    VEML6030_CHECK(scheduler.skipped_polls() == 1);
+
+    VEML6030_CHECK(scheduler.read_next(sample, sequence));
+    VEML6030_CHECK(sequence == 1);
+    VEML6030_CHECK(monotonic_ns() - cycle_start >= 25000000);
+    VEML6030_CHECK(!scheduler.poll(sample, sequence));
+    VEML6030_CHECK(scheduler.skipped_polls() == 2);
+
+    light.enable_interrupt();
+    VEML6030_CHECK(scheduler.read_next(sample, sequence));
+    VEML6030_CHECK(sequence == 2);
+    VEML6030_CHECK(light.get_config_change_ns() == cycle_start);
+    VEML6030_CHECK(monotonic_ns() - cycle_start >= 50000000);
+
+    /* Sleeping through conversions shows up as a gap in the sequence. */
+    usleep(80000);
+    VEML6030_CHECK(scheduler.poll(sample, sequence));
+    VEML6030_CHECK(sequence > 3);
+}
+
+int main() {
+    test_config_generation();
+    test_alignment();
+    return veml6030_test_result();
+}
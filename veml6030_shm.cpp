@@ -0,0 +1,216 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "veml6030_shm.h"
+
+veml6030_shm_publisher::veml6030_shm_publisher() : segment(NULL) {
+    shm_name[0] = '\0';
+}
+
+veml6030_shm_publisher::~veml6030_shm_publisher() {
+    close();
+}
+
+// This function creates the segment, sizes it and lays out the channels. The
+// magic number is stored last, so readers only accept a finished segment.
+bool veml6030_shm_publisher::open(const char *shm_name, uint32_t sensor_count) {
+    int fd_shm;
+    void *mapping;
+
+    close();
+    if ((sensor_count == 0) || (sensor_count > veml6030_shm_max_sensors) ||
+        (strlen(shm_name) >= sizeof(this->shm_name))) {
+        fprintf(stderr, "Invalid shared memory segment %s for %u sensors.\n", shm_name, sensor_count);
+        return false;
+    }
+    fd_shm = shm_open(shm_name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_shm < 0) {
+        perror("shm_open() in veml6030_shm_publisher");
+        return false;
+    }
+    if (ftruncate(fd_shm, sizeof(veml6030_shm_segment)) < 0) {
+        perror("ftruncate() in veml6030_shm_publisher");
+        ::close(fd_shm);
+        return false;
+    }
+    mapping = mmap(NULL, sizeof(veml6030_shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd_shm, 0);
+    ::close(fd_shm);
+    if (mapping == MAP_FAILED) {
+        perror("mmap() in veml6030_shm_publisher");
+        return false;
+    }
+    segment = (veml6030_shm_segment *)mapping;
+    strcpy(this->shm_name, shm_name);
+
+    /* Readers of a previous publisher's segment see it as invalid while it is rebuilt. */
+    segment->magic.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->version = veml6030_shm_version;
+    segment->sensor_count = sensor_count;
+    segment->publisher_pid = getpid();
+    segment->history_capacity = veml6030_shm_history_capacity;
+    for (uint32_t channel = 0; channel < veml6030_shm_max_sensors; ++channel) {
+        segment->channels[channel].sequence.store(0, std::memory_order_relaxed);
+        segment->channels[channel].published.store(0, std::memory_order_relaxed);
+    }
+    segment->magic.store(veml6030_shm_magic, std::memory_order_release);
+    return true;
+}
+
+void veml6030_shm_publisher::close(bool unlink) {
+    if (segment == NULL) {
+        return;
+    }
+    munmap(segment, sizeof(veml6030_shm_segment));
+    segment = NULL;
+    if (unlink) {
+        shm_unlink(shm_name);
+    }
+    shm_name[0] = '\0';
+}
+
+bool veml6030_shm_publisher::is_open() const {
+    return (segment != NULL);
+}
+
+// This function writes record as the channel's latest sample and appends it to
+// the channel's history inside one seqlock write section.
+void veml6030_shm_publisher::publish(uint32_t channel, const veml6030_collector_record &record) {
+    veml6030_shm_channel *shm_channel;
+    uint32_t sequence;
+    uint64_t published;
+
+    if ((segment == NULL) || (channel >= segment->sensor_count)) {
+        return;
+    }
+    shm_channel = &segment->channels[channel];
+    sequence = shm_channel->sequence.load(std::memory_order_relaxed);
+    published = shm_channel->published.load(std::memory_order_relaxed);
+
+    shm_channel->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    shm_channel->latest = record;
+    shm_channel->history[published & (veml6030_shm_history_capacity - 1)] = record;
+    shm_channel->published.store(published + 1, std::memory_order_relaxed);
+    shm_channel->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+veml6030_shm_reader::veml6030_shm_reader() : segment(NULL) {
+}
+
+veml6030_shm_reader::~veml6030_shm_reader() {
+    close();
+}
+
+bool veml6030_shm_reader::open(const char *shm_name) {
+    struct stat segment_status;
+    int fd_shm;
+    void *mapping;
+
+    close();
+    fd_shm = shm_open(shm_name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd_shm < 0) {
+        perror("shm_open() in veml6030_shm_reader");
+        return false;
+    }
+    if ((fstat(fd_shm, &segment_status) < 0) || (segment_status.st_size < (off_t)sizeof(veml6030_shm_segment))) {
+        fprintf(stderr, "Shared memory segment %s is too small.\n", shm_name);
+        ::close(fd_shm);
+        return false;
+    }
+    mapping = mmap(NULL, sizeof(veml6030_shm_segment), PROT_READ, MAP_SHARED, fd_shm, 0);
+    ::close(fd_shm);
+    if (mapping == MAP_FAILED) {
+        perror("mmap() in veml6030_shm_reader");
+        return false;
+    }
+    segment = (const veml6030_shm_segment *)mapping;
+    if ((segment->magic.load(std::memory_order_acquire) != veml6030_shm_magic) ||
+        (segment->version != veml6030_shm_version) ||
+        (segment->history_capacity != veml6030_shm_history_capacity) ||
+        (segment->sensor_count > veml6030_shm_max_sensors)) {
+        fprintf(stderr, "%s isn't a compatible shared memory segment.\n", shm_name);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void veml6030_shm_reader::close() {
+    if (segment != NULL) {
+        munmap((void *)segment, sizeof(veml6030_shm_segment));
+    }
+    segment = NULL;
+}
+
+uint32_t veml6030_shm_reader::sensor_count() const {
+    return (segment != NULL) ? segment->sensor_count : 0;
+}
+
+uint64_t veml6030_shm_reader::published(uint32_t channel) const {
+    if ((segment == NULL) || (channel >= segment->sensor_count)) {
+        return 0;
+    }
+    return segment->channels[channel].published.load(std::memory_order_acquire);
+}
+
+// This function copies the channel's latest sample, retrying while the publisher
+// is writing it.
+bool veml6030_shm_reader::read_latest(uint32_t channel, veml6030_collector_record &record) const {
+    const veml6030_shm_channel *shm_channel;
+    uint32_t sequence;
+    uint64_t published;
+
+    if ((segment == NULL) || (channel >= segment->sensor_count)) {
+        return false;
+    }
+    shm_channel = &segment->channels[channel];
+    do {
+        sequence = shm_channel->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+        published = shm_channel->published.load(std::memory_order_relaxed);
+        record = shm_channel->latest;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || (shm_channel->sequence.load(std::memory_order_relaxed) != sequence));
+    return (published > 0);
+}
+
+// This function copies the most recent max_count samples of the channel, oldest
+// first, retrying while the publisher is writing.
+size_t veml6030_shm_reader::read_history(uint32_t channel, veml6030_collector_record *records,
+                                         size_t max_count) const {
+    const veml6030_shm_channel *shm_channel;
+    uint32_t sequence;
+    size_t count;
+
+    if ((segment == NULL) || (channel >= segment->sensor_count)) {
+        return 0;
+    }
+    if (max_count > veml6030_shm_history_capacity) {
+        max_count = veml6030_shm_history_capacity;
+    }
+    shm_channel = &segment->channels[channel];
+    do {
+        uint64_t published;
+
+        sequence = shm_channel->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+        published = shm_channel->published.load(std::memory_order_relaxed);
+        count = (published < max_count) ? published : max_count;
+        for (size_t i = 0; i < count; ++i) {
+            records[i] = shm_channel->history[(published - count + i) & (veml6030_shm_history_capacity - 1)];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || (shm_channel->sequence.load(std::memory_order_relaxed) != sequence));
+    return count;
+}
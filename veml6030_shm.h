@@ -0,0 +1,101 @@
+#ifndef _VEML6030_SHM_H_
+#define _VEML6030_SHM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "veml6030_collector.h"
+
+// Publication of samples in a POSIX shared memory segment, so any number of
+// local processes can follow the sensors without touching the i2c bus. One
+// publisher (e.g. veml6030_collector --shm) writes; readers map the segment read
+// only and copy out the latest sample or recent history with no syscalls.
+//
+// Each sensor has its own channel guarded by a seqlock: the publisher makes the
+// sequence odd while it writes and even again when it is done, and a reader
+// retries its copy if the sequence was odd or changed while it copied. Readers
+// never block the publisher, and a reader that stops mid-read harms nobody.
+
+static const uint64_t veml6030_shm_magic = 0x4D48533033303656ULL; /* "V6030SHM" */
+static const uint32_t veml6030_shm_version = 1;
+static const uint32_t veml6030_shm_max_sensors = 8;
+static const uint32_t veml6030_shm_history_capacity = 256; // Must be a power of two
+
+// One sensor's channel. Aligned so channels don't share cache lines.
+struct alignas(64) veml6030_shm_channel {
+    std::atomic<uint32_t> sequence;  // Seqlock sequence, odd while being written
+    uint32_t reserved;
+    std::atomic<uint64_t> published; // Samples published so far
+    veml6030_collector_record latest;
+    veml6030_collector_record history[veml6030_shm_history_capacity];
+};
+
+struct veml6030_shm_segment {
+    std::atomic<uint64_t> magic;     // Set last by the publisher, once the segment is ready
+    uint32_t version;
+    uint32_t sensor_count;
+    int32_t publisher_pid;
+    uint32_t history_capacity;
+    alignas(64) veml6030_shm_channel channels[veml6030_shm_max_sensors];
+};
+
+// Writer side. There must be only one publisher per segment.
+class veml6030_shm_publisher {
+  public:
+    veml6030_shm_publisher();
+    ~veml6030_shm_publisher();
+
+    // This function creates (or takes over) the segment shm_name (e.g. "/veml6030")
+    // with room for sensor_count sensors. It returns false on failure.
+    bool open(const char *shm_name, uint32_t sensor_count);
+
+    // This function unmaps the segment. If unlink is true the name is removed too,
+    // so readers that open it later fail instead of seeing stale data.
+    void close(bool unlink = true);
+
+    bool is_open() const;
+
+    // This function makes record the latest sample of channel and adds it to the
+    // channel's history.
+    void publish(uint32_t channel, const veml6030_collector_record &record);
+
+  private:
+    veml6030_shm_segment *segment;
+    char shm_name[256];
+
+    veml6030_shm_publisher(const veml6030_shm_publisher &) = delete;
+    veml6030_shm_publisher &operator=(const veml6030_shm_publisher &) = delete;
+};
+
+// Reader side. Any number of readers can use a segment at once.
+class veml6030_shm_reader {
+  public:
+    veml6030_shm_reader();
+    ~veml6030_shm_reader();
+
+    // This function maps the segment shm_name read only. It returns false if it
+    // doesn't exist or isn't a compatible, initialized segment.
+    bool open(const char *shm_name);
+    void close();
+
+    uint32_t sensor_count() const;
+
+    // This function copies the latest sample of channel into record. It returns
+    // false if nothing has been published on the channel yet.
+    bool read_latest(uint32_t channel, veml6030_collector_record &record) const;
+
+    // This function copies up to max_count of the most recent samples of channel
+    // into records, oldest first, and returns how many were copied.
+    size_t read_history(uint32_t channel, veml6030_collector_record *records, size_t max_count) const;
+
+    // This function returns the number of samples published on channel so far,
+    // which readers can poll cheaply to see if anything new has arrived.
+    uint64_t published(uint32_t channel) const;
+
+  private:
+    const veml6030_shm_segment *segment;
+
+    veml6030_shm_reader(const veml6030_shm_reader &) = delete;
+    veml6030_shm_reader &operator=(const veml6030_shm_reader &) = delete;
+};
+#endif
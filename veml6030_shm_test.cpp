@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+
+#include "veml6030_shm.h"
+#include "veml6030_test.h"
+
+// This function returns a record whose fields all follow from n, so a torn copy
+// of it can be detected.
+static veml6030_collector_record make_record(uint32_t n) {
+    veml6030_collector_record record;
+
+    record.timestamp_ns = (int64_t)n * 1000;
+    record.address = 0x48;
+    record.reserved = 0;
+    record.setting_reg = (uint16_t)(n >> 16);
+    record.ambient_light_bits = (uint16_t)n;
+    record.white_light_bits = (uint16_t)~n;
+    record.ambient_light_lux = n;
+    record.white_light_lux = ~n;
+    return record;
+}
+
+// This function returns true if record is one make_record() would have made.
+static bool is_consistent(const veml6030_collector_record &record) {
+    uint32_t n = record.ambient_light_lux;
+    veml6030_collector_record expected = make_record(n);
+
+    return (record.timestamp_ns == expected.timestamp_ns) && (record.address == expected.address) &&
+           (record.setting_reg == expected.setting_reg) &&
+           (record.ambient_light_bits == expected.ambient_light_bits) &&
+           (record.white_light_bits == expected.white_light_bits) &&
+           (record.white_light_lux == expected.white_light_lux);
+}
+
+// Published records come back from the latest slot and the history, oldest
+// first, with the history keeping only the newest history_capacity records once
+// it wraps. Channels are independent.
+static void test_round_trip(const char *shm_name) {
+    veml6030_shm_publisher publisher;
+    veml6030_shm_reader reader;
+    veml6030_collector_record record;
+    static veml6030_collector_record history[veml6030_shm_history_capacity + 10];
+
+    VEML6030_CHECK(!reader.open(shm_name));
+    VEML6030_CHECK(publisher.open(shm_name, 2));
+    VEML6030_CHECK(reader.open(shm_name));
+    VEML6030_CHECK(reader.sensor_count() == 2);
+    VEML6030_CHECK(!reader.read_latest(0, record));
+    VEML6030_CHECK(reader.read_history(0, history, 10) == 0);
+
+    publisher.publish(0, make_record(1));
+    VEML6030_CHECK(reader.published(0) == 1);
+    VEML6030_CHECK(reader.read_latest(0, record) && (record.ambient_light_lux == 1) && is_consistent(record));
+    VEML6030_CHECK(reader.read_history(0, history, 10) == 1);
+    VEML6030_CHECK(history[0].ambient_light_lux == 1);
+    VEML6030_CHECK(!reader.read_latest(1, record));
+    VEML6030_CHECK(!reader.read_latest(2, record));
+
+    for (uint32_t n = 2; n <= 300; ++n) {
+        publisher.publish(0, make_record(n));
+    }
+    publisher.publish(1, make_record(7));
+    VEML6030_CHECK(reader.published(0) == 300);
+    VEML6030_CHECK(reader.read_latest(0, record) && (record.ambient_light_lux == 300));
+    VEML6030_CHECK(reader.read_latest(1, record) && (record.ambient_light_lux == 7));
+
+    size_t count = reader.read_history(0, history, veml6030_shm_history_capacity + 10);
+    VEML6030_CHECK(count == veml6030_shm_history_capacity);
+    for (size_t i = 0; i < count; ++i) {
+        VEML6030_CHECK(history[i].ambient_light_lux == (300 - veml6030_shm_history_capacity + 1 + i));
+    }
+    VEML6030_CHECK(reader.read_history(0, history, 3) == 3);
+    VEML6030_CHECK((history[0].ambient_light_lux == 298) && (history[2].ambient_light_lux == 300));
+
+    reader.close();
+    publisher.close();
+    VEML6030_CHECK(!reader.open(shm_name));
+}
+
+// A reader racing the publisher never sees a torn record, and sees the latest
+// sample move forwards only.
+static void test_concurrent_reads(const char *shm_name) {
+    veml6030_shm_publisher publisher;
+    veml6030_shm_reader reader;
+    std::atomic<bool> done(false);
+    int torn = 0;
+    int backwards = 0;
+    uint32_t last_seen = 0;
+
+    VEML6030_CHECK(publisher.open(shm_name, 1));
+    VEML6030_CHECK(reader.open(shm_name));
+    std::thread publishing([&]() {
+        for (uint32_t n = 1; n <= 200000; ++n) {
+            publisher.publish(0, make_record(n));
+        }
+        done = true;
+    });
+    while (!done) {
+        veml6030_collector_record record;
+        veml6030_collector_record history[16];
+
+        if (reader.read_latest(0, record)) {
+            if (!is_consistent(record)) {
+                ++torn;
+            } else if (record.ambient_light_lux < last_seen) {
+                ++backwards;
+            } else {
+                last_seen = record.ambient_light_lux;
+            }
+        }
+        size_t count = reader.read_history(0, history, 16);
+        for (size_t i = 0; i < count; ++i) {
+            if (!is_consistent(history[i]) ||
+                ((i > 0) && (history[i].ambient_light_lux != (history[i - 1].ambient_light_lux + 1)))) {
+                ++torn;
+            }
+        }
+    }
+    publishing.join();
+    VEML6030_CHECK(torn == 0);
+    VEML6030_CHECK(backwards == 0);
+    VEML6030_CHECK(reader.published(0) == 200000);
+    reader.close();
+    publisher.close();
+}
+
+int main() {
+    char shm_name[64];
+
+    snprintf(shm_name, sizeof(shm_name), "/veml6030_shm_test_%d", (int)getpid());
+    test_round_trip(shm_name);
+    test_concurrent_reads(shm_name);
+    return veml6030_test_result();
+}
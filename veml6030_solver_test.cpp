@@ -0,0 +1,75 @@
+#include <errno.h>
+#include <stdint.h>
+
+#include "veml6030_config_solver.h"
+#include "veml6030_test.h"
+
+// This function solves for samples_per_second with no other constraint.
+static bool solve_rate(float samples_per_second, veml6030_operating_point &point) {
+    veml6030_config_request request = {};
+
+    request.samples_per_second = samples_per_second;
+    return veml6030_solve_config(request, point);
+}
+
+// Each rate gets the lowest current combination from the datasheet IDD table.
+static void test_rates() {
+    veml6030_operating_point point;
+
+    /* 1/s: 100ms in power save mode 1 (600ms refresh, 8uA) beats 400ms in mode 1 (20uA). */
+    VEML6030_CHECK(solve_rate(1, point));
+    VEML6030_CHECK((point.integration_time_ms == 100) && (point.power_save_mode == 1));
+    VEML6030_CHECK(point.refresh_period_ms == 600);
+    VEML6030_CHECK(point.current_ua == 8);
+    VEML6030_CHECK(point.gain == 2);
+
+    /* 0.5/s: mode 2 fits in 2s, mode 3 doesn't. */
+    VEML6030_CHECK(solve_rate(0.5, point));
+    VEML6030_CHECK((point.integration_time_ms == 100) && (point.power_save_mode == 2));
+    VEML6030_CHECK(point.current_ua == 5);
+
+    /* 0.1/s: the longest wait at the shortest integration time draws least. */
+    VEML6030_CHECK(solve_rate(0.1, point));
+    VEML6030_CHECK((point.integration_time_ms == 100) && (point.power_save_mode == 4));
+    VEML6030_CHECK(point.refresh_period_ms == 4100);
+    VEML6030_CHECK(point.current_ua == 2);
+
+    /* 10/s: too fast for power save mode, so the longest continuous integration time. */
+    VEML6030_CHECK(solve_rate(10, point));
+    VEML6030_CHECK((point.integration_time_ms == 100) && (point.power_save_mode == 0));
+    VEML6030_CHECK(point.current_ua == 45);
+
+    /* 40/s is just possible at 25ms, anything faster isn't. */
+    VEML6030_CHECK(solve_rate(40, point));
+    VEML6030_CHECK(point.integration_time_ms == 25);
+    VEML6030_CHECK(!solve_rate(41, point));
+    VEML6030_CHECK(!solve_rate(2000, point));
+}
+
+// Range and resolution constraints rule out combinations before current is compared.
+static void test_constraints() {
+    veml6030_config_request request = {};
+    veml6030_operating_point point;
+
+    request.samples_per_second = 1;
+    request.max_lux = 100000;
+    VEML6030_CHECK(veml6030_solve_config(request, point));
+    VEML6030_CHECK(point.max_lux >= 100000);
+    VEML6030_CHECK(point.gain == 0.125f);
+
+    request.max_lux = 0;
+    request.lux_resolution = 0.01f;
+    VEML6030_CHECK(veml6030_solve_config(request, point));
+    VEML6030_CHECK(point.lux_per_count <= 0.01f);
+    VEML6030_CHECK(point.integration_time_ms >= 400);
+
+    /* Finer than the finest resolution the sensor has. */
+    request.lux_resolution = 0.001f;
+    VEML6030_CHECK(!veml6030_solve_config(request, point));
+}
+
+int main() {
+    test_rates();
+    test_constraints();
+    return veml6030_test_result();
+}
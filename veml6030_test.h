@@ -0,0 +1,27 @@
+#ifndef _VEML6030_TEST_H_
+#define _VEML6030_TEST_H_
+
+#include <stdio.h>
+
+// Minimal checks for the ctest programs. A failed check is reported and counted,
+// and the test continues so one run shows every failure; main() returns
+// veml6030_test_result() so ctest sees the failure.
+static int veml6030_test_failures = 0;
+
+#define VEML6030_CHECK(condition) veml6030_test_check((condition), #condition, __FILE__, __LINE__)
+
+static inline void veml6030_test_check(bool passed, const char *condition, const char *file, int line) {
+    if (!passed) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        ++veml6030_test_failures;
+    }
+}
+
+static inline int veml6030_test_result() {
+    if (veml6030_test_failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", veml6030_test_failures);
+        return 1;
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,301 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+
+#include "veml6030_transport.h"
+
+// This function performs the reads one at a time, for transports that can't batch.
+int veml6030_transport::read_registers(veml6030_register_read *reads, int read_count) {
+    int return_code = 0;
+
+    for (int i = 0; i < read_count; ++i) {
+        reads[i].status = read_register(reads[i].slave_address, reads[i].reg, reads[i].reg_value);
+        if ((reads[i].status < 0) && (return_code == 0)) {
+            return_code = reads[i].status;
+        }
+    }
+    return return_code;
+}
+
+// This function returns -EOPNOTSUPP; there is nothing to reopen.
+int veml6030_transport::reopen() {
+    return -EOPNOTSUPP;
+}
+
+linux_i2c_transport::linux_i2c_transport(const char *i2c_bus_name) : i2c_bus_name(i2c_bus_name) {
+    fd_i2c_file = open(i2c_bus_name, O_RDWR);
+    if (fd_i2c_file < 0) {
+        perror("open() of i2c bus in linux_i2c_transport");
+    }
+}
+
+linux_i2c_transport::~linux_i2c_transport() {
+    if (fd_i2c_file >= 0) {
+        close(fd_i2c_file);
+    }
+}
+
+bool linux_i2c_transport::is_open() const {
+    return (fd_i2c_file >= 0);
+}
+
+// This function closes and reopens the i2c bus device.
+int linux_i2c_transport::reopen() {
+    if (fd_i2c_file >= 0) {
+        close(fd_i2c_file);
+    }
+    fd_i2c_file = open(i2c_bus_name.c_str(), O_RDWR);
+    if (fd_i2c_file < 0) {
+        int saved_errno = errno;
+        perror("open() of i2c bus in linux_i2c_transport::reopen");
+        return -saved_errno;
+    }
+    return 0;
+}
+
+// This function reads a 16 bit register with one write (register address) and
+// one read (register value) message in a single I2C_RDWR ioctl.
+int linux_i2c_transport::read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value) {
+    struct i2c_msg messages[2];
+    struct i2c_rdwr_ioctl_data message_set[1];
+    uint8_t in_buffer[2];
+    uint8_t out_buffer[1];
+    int64_t start_ns;
+
+    /* Set up the output operation first. */
+    messages[0].addr = slave_address;
+    messages[0].flags = 0;
+    messages[0].len = sizeof(out_buffer);
+    messages[0].buf = out_buffer;
+
+    /* Now set up the input operation. */
+    messages[1].addr = slave_address;
+    messages[1].flags = (I2C_M_RD | I2C_M_NOSTART);
+    messages[1].len = sizeof(in_buffer);
+    messages[1].buf = in_buffer;
+
+    /* Now arrange things for the ioctl. */
+    message_set[0].msgs = messages;
+    message_set[0].nmsgs = 2;
+
+    out_buffer[0] = read_reg;
+
+    in_buffer[0] = read_reg;
+    in_buffer[1] = 0;
+    start_ns = stats.transaction_start();
+    stats.record_read(read_reg);
+    if (ioctl(fd_i2c_file, I2C_RDWR, &message_set) < 0) {
+        int saved_errno = errno;
+        stats.record_transaction(start_ns, -saved_errno);
+        perror("ioctl(I2C_RDWR) in read_register");
+        return -saved_errno;
+    }
+    stats.record_transaction(start_ns, 0);
+    reg_value = (in_buffer[1] << 8) | in_buffer[0];
+    return 0;
+}
+
+// This function packs the reads into as few I2C_RDWR ioctls as the kernel's
+// message limit allows. Each read is the same write/read message pair used by
+// read_register(). If an ioctl fails, every read it carried gets its errno.
+int linux_i2c_transport::read_registers(veml6030_register_read *reads, int read_count) {
+    static const int reads_per_ioctl = I2C_RDWR_IOCTL_MAX_MSGS / 2;
+    struct i2c_msg messages[reads_per_ioctl * 2];
+    struct i2c_rdwr_ioctl_data message_set[1];
+    uint8_t in_buffers[reads_per_ioctl][2];
+    uint8_t out_buffers[reads_per_ioctl][1];
+    int return_code = 0;
+
+    for (int first = 0; first < read_count; first += reads_per_ioctl) {
+        int batch_count = read_count - first;
+        int batch_status = 0;
+        int64_t start_ns;
+
+        if (batch_count > reads_per_ioctl) {
+            batch_count = reads_per_ioctl;
+        }
+        for (int i = 0; i < batch_count; ++i) {
+            veml6030_register_read *read = &reads[first + i];
+
+            stats.record_read(read->reg);
+            out_buffers[i][0] = read->reg;
+            messages[(i * 2)].addr = read->slave_address;
+            messages[(i * 2)].flags = 0;
+            messages[(i * 2)].len = sizeof(out_buffers[i]);
+            messages[(i * 2)].buf = out_buffers[i];
+
+            in_buffers[i][0] = read->reg;
+            in_buffers[i][1] = 0;
+            messages[(i * 2) + 1].addr = read->slave_address;
+            messages[(i * 2) + 1].flags = (I2C_M_RD | I2C_M_NOSTART);
+            messages[(i * 2) + 1].len = sizeof(in_buffers[i]);
+            messages[(i * 2) + 1].buf = in_buffers[i];
+        }
+        message_set[0].msgs = messages;
+        message_set[0].nmsgs = batch_count * 2;
+        start_ns = stats.transaction_start();
+        if (ioctl(fd_i2c_file, I2C_RDWR, &message_set) < 0) {
+            batch_status = -errno;
+            perror("ioctl(I2C_RDWR) in read_registers");
+            if (return_code == 0) {
+                return_code = batch_status;
+            }
+        }
+        stats.record_transaction(start_ns, batch_status);
+        for (int i = 0; i < batch_count; ++i) {
+            veml6030_register_read *read = &reads[first + i];
+
+            read->status = batch_status;
+            if (batch_status == 0) {
+                read->reg_value = (in_buffers[i][1] << 8) | in_buffers[i][0];
+            }
+        }
+    }
+    return return_code;
+}
+
+// This function writes a 16 bit register as a single three byte I2C_RDWR message.
+int linux_i2c_transport::write_register(int slave_address, uint8_t write_reg, uint16_t reg_value) {
+    struct i2c_msg messages[1];
+    struct i2c_rdwr_ioctl_data message_set[1];
+    uint8_t out_buffer[3];
+    int64_t start_ns;
+
+    /* Set up the output operation. */
+    messages[0].addr = slave_address;
+    messages[0].flags = 0;
+    messages[0].len = sizeof(out_buffer);
+    messages[0].buf = out_buffer;
+
+    /* Now arrange things for the ioctl. */
+    message_set[0].msgs = messages;
+    message_set[0].nmsgs = 1;
+
+    out_buffer[0] = write_reg;
+    out_buffer[1] = (reg_value & 0xff);
+    out_buffer[2] = ((reg_value >> 8) & 0xff);
+    start_ns = stats.transaction_start();
+    stats.record_write(write_reg);
+    if (ioctl(fd_i2c_file, I2C_RDWR, &message_set) < 0) {
+        int saved_errno = errno;
+        stats.record_transaction(start_ns, -saved_errno);
+        perror("ioctl(I2C_RDWR) in write_register");
+        return -saved_errno;
+    }
+    stats.record_transaction(start_ns, 0);
+    return 0;
+}
+
+smbus_transport::smbus_transport(const char *i2c_bus_name) : i2c_bus_name(i2c_bus_name) {
+    current_slave_address = -1;
+    fd_i2c_file = open(i2c_bus_name, O_RDWR);
+    if (fd_i2c_file < 0) {
+        perror("open() of i2c bus in smbus_transport");
+    }
+}
+
+smbus_transport::~smbus_transport() {
+    if (fd_i2c_file >= 0) {
+        close(fd_i2c_file);
+    }
+}
+
+bool smbus_transport::is_open() const {
+    return (fd_i2c_file >= 0);
+}
+
+// This function closes and reopens the i2c bus device. The slave address has to
+// be selected again afterwards.
+int smbus_transport::reopen() {
+    if (fd_i2c_file >= 0) {
+        close(fd_i2c_file);
+    }
+    current_slave_address = -1;
+    fd_i2c_file = open(i2c_bus_name.c_str(), O_RDWR);
+    if (fd_i2c_file < 0) {
+        int saved_errno = errno;
+        perror("open() of i2c bus in smbus_transport::reopen");
+        return -saved_errno;
+    }
+    return 0;
+}
+
+// This function points the file at slave_address if it isn't already. The SMBus
+// ioctls don't carry an address, so the I2C_SLAVE setting is cached to avoid an
+// extra syscall per access when only one sensor is used.
+int smbus_transport::select_slave(int slave_address) {
+    if (slave_address != current_slave_address) {
+        if (ioctl(fd_i2c_file, I2C_SLAVE, slave_address) < 0) {
+            int saved_errno = errno;
+            perror("ioctl(I2C_SLAVE) in smbus_transport");
+            current_slave_address = -1;
+            return -saved_errno;
+        }
+        current_slave_address = slave_address;
+    }
+    return 0;
+}
+
+// This function reads a 16 bit register with an SMBus read word data transfer.
+// SMBus words are sent low byte first, which matches the VEML6030.
+int smbus_transport::read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value) {
+    union i2c_smbus_data data;
+    struct i2c_smbus_ioctl_data args;
+    int64_t start_ns;
+    int return_code;
+
+    return_code = select_slave(slave_address);
+    if (return_code < 0) {
+        return return_code;
+    }
+    args.read_write = I2C_SMBUS_READ;
+    args.command = read_reg;
+    args.size = I2C_SMBUS_WORD_DATA;
+    args.data = &data;
+    start_ns = stats.transaction_start();
+    stats.record_read(read_reg);
+    if (ioctl(fd_i2c_file, I2C_SMBUS, &args) < 0) {
+        int saved_errno = errno;
+        stats.record_transaction(start_ns, -saved_errno);
+        perror("ioctl(I2C_SMBUS) in read_register");
+        return -saved_errno;
+    }
+    stats.record_transaction(start_ns, 0);
+    reg_value = data.word;
+    return 0;
+}
+
+// This function writes a 16 bit register with an SMBus write word data transfer.
+int smbus_transport::write_register(int slave_address, uint8_t write_reg, uint16_t reg_value) {
+    union i2c_smbus_data data;
+    struct i2c_smbus_ioctl_data args;
+    int64_t start_ns;
+    int return_code;
+
+    return_code = select_slave(slave_address);
+    if (return_code < 0) {
+        return return_code;
+    }
+    data.word = reg_value;
+    args.read_write = I2C_SMBUS_WRITE;
+    args.command = write_reg;
+    args.size = I2C_SMBUS_WORD_DATA;
+    args.data = &data;
+    start_ns = stats.transaction_start();
+    stats.record_write(write_reg);
+    if (ioctl(fd_i2c_file, I2C_SMBUS, &args) < 0) {
+        int saved_errno = errno;
+        stats.record_transaction(start_ns, -saved_errno);
+        perror("ioctl(I2C_SMBUS) in write_register");
+        return -saved_errno;
+    }
+    stats.record_transaction(start_ns, 0);
+    return 0;
+}
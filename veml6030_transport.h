@@ -0,0 +1,107 @@
+#ifndef _VEML6030_TRANSPORT_H_
+#define _VEML6030_TRANSPORT_H_
+
+#include <stdint.h>
+#include <string>
+#include "veml6030_i2c_stats.h"
+
+// One register read in a batch. The transport fills in reg_value and status (0 or
+// a negative errno value) for each entry.
+struct veml6030_register_read {
+    int slave_address;
+    uint8_t reg;
+    uint16_t reg_value;
+    int status;
+};
+
+// Register level access to a VEML6030 on some bus. The driver only ever talks to
+// the sensor through one of these, so the same driver code runs over the Linux
+// i2c-dev I2C_RDWR interface, the SMBus interface, or an in-process fake.
+//
+// All register values are the 16 bit host order values (the VEML6030 sends the
+// low byte first on the wire). Functions return 0 on success or a negative errno
+// value on failure.
+class veml6030_transport {
+  public:
+    virtual ~veml6030_transport() {}
+
+    // This function reads the 16 bit register read_reg of the sensor at slave_address.
+    virtual int read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value) = 0;
+
+    // This function writes reg_value to the 16 bit register write_reg of the sensor at slave_address.
+    virtual int write_register(int slave_address, uint8_t write_reg, uint16_t reg_value) = 0;
+
+    // This function performs read_count register reads, possibly for several
+    // sensors, as one batch. It returns 0 if every read succeeded, otherwise the
+    // status of the first one that failed. The default does one read at a time.
+    virtual int read_registers(veml6030_register_read *reads, int read_count);
+
+    // This function closes and reopens the underlying bus device, to recover from
+    // an adapter that has stopped responding. It returns 0 or a negative errno
+    // value; transports with nothing to reopen return -EOPNOTSUPP.
+    virtual int reopen();
+
+    // These functions return the transport's transaction counters.
+    const veml6030_i2c_stats &get_stats() const {
+        return stats;
+    }
+    veml6030_i2c_stats &get_stats() {
+        return stats;
+    }
+
+  protected:
+    veml6030_i2c_stats stats;
+};
+
+// Transport using the i2c-dev I2C_RDWR ioctl, which lets each register access be a
+// single combined write/read transaction on the bus.
+class linux_i2c_transport : public veml6030_transport {
+  public:
+    linux_i2c_transport(const char *i2c_bus_name = "/dev/i2c-1");
+    ~linux_i2c_transport();
+
+    // This function returns true if the i2c bus device was opened.
+    bool is_open() const;
+
+    int read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value);
+    int write_register(int slave_address, uint8_t write_reg, uint16_t reg_value);
+    int reopen();
+
+    // This function packs the reads into as few I2C_RDWR ioctls as the kernel's
+    // message limit allows, so a whole batch usually costs a single syscall.
+    int read_registers(veml6030_register_read *reads, int read_count);
+
+  private:
+    std::string i2c_bus_name;
+    int fd_i2c_file;
+
+    linux_i2c_transport(const linux_i2c_transport &) = delete;
+    linux_i2c_transport &operator=(const linux_i2c_transport &) = delete;
+};
+
+// Transport using the i2c-dev SMBus read/write word ioctls, for adapters that
+// don't implement I2C_RDWR.
+class smbus_transport : public veml6030_transport {
+  public:
+    smbus_transport(const char *i2c_bus_name = "/dev/i2c-1");
+    ~smbus_transport();
+
+    // This function returns true if the i2c bus device was opened.
+    bool is_open() const;
+
+    int read_register(int slave_address, uint8_t read_reg, uint16_t &reg_value);
+    int write_register(int slave_address, uint8_t write_reg, uint16_t reg_value);
+    int reopen();
+
+  private:
+    std::string i2c_bus_name;
+    int fd_i2c_file;
+    int current_slave_address;
+
+    // This function points the file at slave_address if it isn't already.
+    int select_slave(int slave_address);
+
+    smbus_transport(const smbus_transport &) = delete;
+    smbus_transport &operator=(const smbus_transport &) = delete;
+};
+#endif
@@ -0,0 +1,122 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "veml6030_window_extrema.h"
+
+veml6030_window_extrema::entry &veml6030_window_extrema::entry_deque::front() {
+    return entries[first];
+}
+
+veml6030_window_extrema::entry &veml6030_window_extrema::entry_deque::back() {
+    size_t slot = first + count - 1;
+
+    if (slot >= entries.size()) {
+        slot -= entries.size();
+    }
+    return entries[slot];
+}
+
+void veml6030_window_extrema::entry_deque::push_back(const entry &new_entry) {
+    size_t slot = first + count;
+
+    if (slot >= entries.size()) {
+        slot -= entries.size();
+    }
+    entries[slot] = new_entry;
+    ++count;
+}
+
+void veml6030_window_extrema::entry_deque::pop_front() {
+    if (++first == entries.size()) {
+        first = 0;
+    }
+    --count;
+}
+
+void veml6030_window_extrema::entry_deque::pop_back() {
+    --count;
+}
+
+veml6030_window_extrema::veml6030_window_extrema(size_t window_size)
+    : window_size(window_size > 0 ? window_size : 1),
+      next_index(0) {
+    min_deque.entries.resize(this->window_size);
+    max_deque.entries.resize(this->window_size);
+    clear();
+}
+
+void veml6030_window_extrema::push(double value) {
+    push(value, value);
+}
+
+// This function adds an entry. Entries that can no longer be the extreme (older
+// and not more extreme than the new one) are dropped from the back of each deque,
+// and the entry leaving the window from the front.
+void veml6030_window_extrema::push(double min_value, double max_value) {
+    entry min_entry;
+    entry max_entry;
+
+    min_entry.index = next_index++;
+    min_entry.value = min_value;
+    max_entry.index = min_entry.index;
+    max_entry.value = max_value;
+
+    while ((min_deque.count > 0) && (min_deque.back().value >= min_value)) {
+        min_deque.pop_back();
+    }
+    while ((max_deque.count > 0) && (max_deque.back().value <= max_value)) {
+        max_deque.pop_back();
+    }
+    if ((min_deque.count > 0) && ((min_entry.index - min_deque.front().index) >= window_size)) {
+        min_deque.pop_front();
+    }
+    if ((max_deque.count > 0) && ((max_entry.index - max_deque.front().index) >= window_size)) {
+        max_deque.pop_front();
+    }
+    min_deque.push_back(min_entry);
+    max_deque.push_back(max_entry);
+}
+
+void veml6030_window_extrema::clear() {
+    next_index = 0;
+    min_deque.first = 0;
+    min_deque.count = 0;
+    max_deque.first = 0;
+    max_deque.count = 0;
+}
+
+bool veml6030_window_extrema::empty() const {
+    return (min_deque.count == 0);
+}
+
+double veml6030_window_extrema::min() const {
+    return min_deque.entries[min_deque.first].value;
+}
+
+double veml6030_window_extrema::max() const {
+    return max_deque.entries[max_deque.first].value;
+}
+
+// This function decides whether an axis needs to change to show data_min to
+// data_max, and returns the new range if it does.
+bool veml6030_axis_range_update(double data_min, double data_max, double &axis_min, double &axis_max) {
+    double margin = (data_max - data_min) / 10;
+    double new_min;
+    double new_max;
+
+    if (margin < 1) {
+        margin = 1;
+    }
+    if ((data_min >= axis_min) && (data_max <= axis_max) &&
+        ((data_max - data_min + (2 * margin)) * 2 >= (axis_max - axis_min))) {
+        return false;
+    }
+    new_min = data_min - margin;
+    if ((new_min < 0) && (data_min >= 0)) {
+        new_min = 0;
+    }
+    new_max = data_max + margin;
+    axis_min = new_min;
+    axis_max = new_max;
+    return true;
+}
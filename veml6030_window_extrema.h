@@ -0,0 +1,62 @@
+#ifndef _VEML6030_WINDOW_EXTREMA_H_
+#define _VEML6030_WINDOW_EXTREMA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Minimum and maximum of the last window_size values pushed, kept with two
+// monotonic deques. An entry can also carry a separate minimum and maximum, such
+// as a rollup bucket's. Each value enters and leaves each deque at most once, so a
+// push is O(1) amortized and reading the extrema is O(1). The deques are fixed
+// size rings, so nothing is allocated after construction.
+class veml6030_window_extrema {
+  public:
+    veml6030_window_extrema(size_t window_size);
+
+    // This function adds a value, retiring the one window_size pushes ago.
+    void push(double value);
+
+    // This function adds an entry whose extremes are min_value and max_value,
+    // retiring the one window_size pushes ago.
+    void push(double min_value, double max_value);
+
+    void clear();
+    bool empty() const;
+
+    // These functions return the extrema of the window. It must not be empty.
+    double min() const;
+    double max() const;
+
+  private:
+    struct entry {
+        uint64_t index;
+        double value;
+    };
+
+    // A double ended queue of entries in a fixed size ring.
+    struct entry_deque {
+        std::vector<entry> entries;
+        size_t first;
+        size_t count;
+
+        entry &front();
+        entry &back();
+        void push_back(const entry &new_entry);
+        void pop_front();
+        void pop_back();
+    };
+
+    size_t window_size;
+    uint64_t next_index;
+    entry_deque min_deque; // Values increase from front to back; the front is the minimum
+    entry_deque max_deque; // Values decrease from front to back; the front is the maximum
+};
+
+// This function decides whether an axis showing axis_min to axis_max needs to
+// change to show data_min to data_max. The axis gets a margin of a tenth of the
+// data span on each side. It is only moved when data falls outside it, or when
+// the data has shrunk to less than half of it, so small changes in the extrema
+// don't relayout the chart. It returns true and the new range if it changed.
+bool veml6030_axis_range_update(double data_min, double data_max, double &axis_min, double &axis_max);
+#endif
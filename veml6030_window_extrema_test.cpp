@@ -0,0 +1,95 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "veml6030_rollup.h"
+#include "veml6030_window_extrema.h"
+#include "veml6030_test.h"
+
+// The tracker agrees with a brute force scan of the window after every push.
+static void test_against_scan() {
+    for (size_t window_size = 1; window_size <= 33; window_size += 8) {
+        veml6030_window_extrema extrema(window_size);
+        std::vector<double> values;
+        bool matched = true;
+
+        srand(1);
+        for (int i = 0; i < 1000; ++i) {
+            double value = rand() % 100;
+            size_t first = 0;
+            double scan_min;
+            double scan_max;
+
+            values.push_back(value);
+            extrema.push(value);
+            if (values.size() > window_size) {
+                first = values.size() - window_size;
+            }
+            scan_min = values[first];
+            scan_max = values[first];
+            for (size_t j = first; j < values.size(); ++j) {
+                scan_min = (values[j] < scan_min) ? values[j] : scan_min;
+                scan_max = (values[j] > scan_max) ? values[j] : scan_max;
+            }
+            if ((extrema.min() != scan_min) || (extrema.max() != scan_max)) {
+                matched = false;
+            }
+        }
+        VEML6030_CHECK(matched);
+    }
+}
+
+// Entries with separate extremes, as rollup buckets push them.
+static void test_range_entries() {
+    veml6030_window_extrema extrema(2);
+
+    VEML6030_CHECK(extrema.empty());
+    extrema.push(5, 50);
+    extrema.push(10, 20);
+    VEML6030_CHECK((extrema.min() == 5) && (extrema.max() == 50));
+    extrema.push(8, 9);
+    VEML6030_CHECK((extrema.min() == 8) && (extrema.max() == 20));
+    extrema.clear();
+    VEML6030_CHECK(extrema.empty());
+}
+
+// The rollup store's extrema follow what its hour ring still covers.
+static void test_rollup_extrema() {
+    veml6030_rollup_store store(16, 16, 16, 4);
+    const int64_t hour_ms = 60 * 60 * 1000;
+
+    for (int64_t hour = 0; hour < 10; ++hour) {
+        store.append(hour * hour_ms, (hour == 1) ? 1000 : hour);
+        store.append((hour * hour_ms) + 1000, (hour == 2) ? -5 : hour);
+        if (hour == 3) {
+            VEML6030_CHECK((store.min_value() == -5) && (store.max_value() == 1000));
+        }
+    }
+    /* Hours 6 to 9 are left, so the spike and the dip have gone. */
+    VEML6030_CHECK(store.oldest_ms() == (6 * hour_ms));
+    VEML6030_CHECK((store.min_value() == 6) && (store.max_value() == 9));
+
+    store.append(10 * hour_ms, 2);
+    VEML6030_CHECK(store.min_value() == 2);
+}
+
+// The axis only moves when the data leaves it or shrinks to under half of it.
+static void test_axis_hysteresis() {
+    double axis_min = 0;
+    double axis_max = 0;
+
+    VEML6030_CHECK(veml6030_axis_range_update(100, 200, axis_min, axis_max));
+    VEML6030_CHECK((axis_min == 90) && (axis_max == 210));
+    VEML6030_CHECK(!veml6030_axis_range_update(110, 190, axis_min, axis_max));
+    VEML6030_CHECK(veml6030_axis_range_update(100, 250, axis_min, axis_max));
+    VEML6030_CHECK(veml6030_axis_range_update(150, 160, axis_min, axis_max));
+    VEML6030_CHECK((axis_min == 149) && (axis_max == 161));
+}
+
+int main() {
+    test_against_scan();
+    test_range_entries();
+    test_rollup_extrema();
+    test_axis_hysteresis();
+    return veml6030_test_result();
+}